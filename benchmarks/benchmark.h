@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace dm::benchmark {
+
+// Fastest of `repeats` runs of body(), in milliseconds. setup() runs before each of them and is not timed.
+template <typename Setup, typename Body>
+[[nodiscard]] double best_milliseconds(int repeats, Setup&& setup, Body&& body)
+{
+    double best = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < repeats; ++i) {
+        setup();
+        const auto start = std::chrono::steady_clock::now();
+        body();
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+template <typename Body>
+[[nodiscard]] double best_milliseconds(int repeats, Body&& body)
+{
+    return best_milliseconds(repeats, [] {}, body);
+}
+
+// Suites, each printing its own results to stdout.
+void run_constraints();
+void run_orca();
+void run_offset();
+void run_polar();
+void run_geodesy();
+void run_hpa();
+void run_tour();
+
+} // namespace dm::benchmark
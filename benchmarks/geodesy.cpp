@@ -0,0 +1,106 @@
+#include "benchmark.h"
+
+#include "fast_math.h"
+#include "geodesy.h"
+#include "vec2.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+
+#include <algorithm>
+#include <numbers>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace dm::benchmark {
+
+namespace {
+
+constexpr double radians = std::numbers::pi / 180;
+
+[[nodiscard]] double libm_haversine(const Vec2<double>& from, const Vec2<double>& to)
+{
+    const double sin_dlat = std::sin((to.y() - from.y()) * radians / 2);
+    const double sin_dlon = std::sin((to.x() - from.x()) * radians / 2);
+    const double h =
+        sin_dlat * sin_dlat + std::cos(from.y() * radians) * std::cos(to.y() * radians) * sin_dlon * sin_dlon;
+    return 2 * earth_radius * std::asin(std::sqrt(std::min(h, 1.0)));
+}
+
+[[nodiscard]] Vec2<double> libm_to_web_mercator(const Vec2<double>& lon_lat)
+{
+    const double latitude = std::clamp(lon_lat.y(), -web_mercator_max_latitude, web_mercator_max_latitude);
+    return Vec2<double>(lon_lat.x() * radians * web_mercator_radius,
+                        web_mercator_radius * std::log(std::tan(std::numbers::pi / 4 + latitude * radians / 2)));
+}
+
+struct Reference
+{
+    std::vector<double> distances;
+    std::vector<Vec2<double>> projected;
+    double distance_ms;
+    double projection_ms;
+};
+
+template <Accuracy A>
+void report(const char* name, std::span<const Vec2<double>> from, std::span<const Vec2<double>> to,
+            const Reference& libm)
+{
+    constexpr int repeats = 5;
+    std::vector<double> distances(from.size());
+    std::vector<Vec2<double>> projected(from.size());
+    const double distance_ms = best_milliseconds(repeats, [&] { haversine_distances<A>(from, to, distances); });
+    const double projection_ms =
+        best_milliseconds(repeats, [&] { to_web_mercator<A>(from, std::span<Vec2<double>>{projected}); });
+    double distance_error = 0;
+    double projection_error = 0;
+    for (std::size_t i = 0; i < from.size(); ++i) {
+        distance_error = std::max(distance_error, std::abs(distances[i] - libm.distances[i]));
+        projection_error = std::max(projection_error, Vec2<double>::distance(projected[i], libm.projected[i]));
+    }
+    std::printf("  %-8s haversine %8.2f ms %5.2fx  max error %8.2e m | mercator %8.2f ms %5.2fx  max error %8.2e m\n",
+                name, distance_ms, libm.distance_ms / distance_ms, distance_error, projection_ms,
+                libm.projection_ms / projection_ms, projection_error);
+}
+
+} // namespace
+
+// Batch haversine distances and Web Mercator projections of random points worldwide at every Accuracy, against plain
+// libm loops. The batch functions use every hardware thread; the libm loops run on one.
+void run_geodesy()
+{
+    constexpr std::size_t count = std::size_t{1} << 22;
+    constexpr int repeats = 5;
+    std::mt19937_64 random{11};
+    std::uniform_real_distribution<double> longitude{-180, 180};
+    std::uniform_real_distribution<double> latitude{-85, 85};
+    std::vector<Vec2<double>> from(count);
+    std::vector<Vec2<double>> to(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        from[i] = Vec2<double>(longitude(random), latitude(random));
+        to[i] = Vec2<double>(longitude(random), latitude(random));
+    }
+
+    Reference libm{std::vector<double>(count), std::vector<Vec2<double>>(count), 0, 0};
+    libm.distance_ms = best_milliseconds(repeats, [&] {
+        for (std::size_t i = 0; i < count; ++i) {
+            libm.distances[i] = libm_haversine(from[i], to[i]);
+        }
+    });
+    libm.projection_ms = best_milliseconds(repeats, [&] {
+        for (std::size_t i = 0; i < count; ++i) {
+            libm.projected[i] = libm_to_web_mercator(from[i]);
+        }
+    });
+
+    std::printf("%zu point pairs\n", count);
+    std::printf("  libm     haversine %8.2f ms                           | mercator %8.2f ms\n", libm.distance_ms,
+                libm.projection_ms);
+    report<Accuracy::low>("low", from, to, libm);
+    report<Accuracy::medium>("medium", from, to, libm);
+    report<Accuracy::high>("high", from, to, libm);
+}
+
+} // namespace dm::benchmark
@@ -0,0 +1,195 @@
+#include "benchmark.h"
+
+#include "hpa.h"
+#include "vec2.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace dm::benchmark {
+
+namespace {
+
+// Plain A* over every cell, 4-connected with unit costs and the Manhattan heuristic, as the baseline HPA* replaces.
+// Returns the path length in steps, or -1 if the goal is unreachable.
+class FlatAStar
+{
+  public:
+    FlatAStar(int width, int height, const std::vector<std::uint8_t>& walkable)
+        : width_{width}, height_{height}, walkable_{walkable}, cost_(walkable.size(), unvisited)
+    {
+    }
+
+    [[nodiscard]] int find_path(const Vec2<int>& start, const Vec2<int>& goal)
+    {
+        for (const std::size_t cell : touched_) {
+            cost_[cell] = unvisited;
+        }
+        touched_.clear();
+        const auto heuristic = [&](int x, int y) { return std::abs(x - goal.x()) + std::abs(y - goal.y()); };
+        // (f, -g, cell): ties go to the deeper node, which reaches the goal sooner on open ground.
+        using Entry = std::tuple<int, int, std::size_t>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<>> open;
+        const std::size_t first = index(start.x(), start.y());
+        cost_[first] = 0;
+        touched_.push_back(first);
+        open.emplace(heuristic(start.x(), start.y()), 0, first);
+        const std::size_t target = index(goal.x(), goal.y());
+        while (!open.empty()) {
+            const auto [f, negative_cost, cell] = open.top();
+            open.pop();
+            if (cell == target) {
+                return -negative_cost;
+            }
+            if (-negative_cost > cost_[cell]) {
+                continue;
+            }
+            const int x = static_cast<int>(cell % static_cast<std::size_t>(width_));
+            const int y = static_cast<int>(cell / static_cast<std::size_t>(width_));
+            const int cost = -negative_cost + 1;
+            const std::pair<int, int> neighbors[] = {{x + 1, y}, {x - 1, y}, {x, y + 1}, {x, y - 1}};
+            for (const auto& [nx, ny] : neighbors) {
+                if (nx < 0 || ny < 0 || nx >= width_ || ny >= height_) {
+                    continue;
+                }
+                const std::size_t next = index(nx, ny);
+                if (walkable_[next] == 0 || cost >= cost_[next]) {
+                    continue;
+                }
+                if (cost_[next] == unvisited) {
+                    touched_.push_back(next);
+                }
+                cost_[next] = cost;
+                open.emplace(cost + heuristic(nx, ny), -cost, next);
+            }
+        }
+        return -1;
+    }
+
+  private:
+    static constexpr int unvisited = std::numeric_limits<int>::max();
+
+    int width_;
+    int height_;
+    const std::vector<std::uint8_t>& walkable_;
+    std::vector<int> cost_;
+    std::vector<std::size_t> touched_;
+
+    [[nodiscard]] std::size_t index(int x, int y) const noexcept
+    {
+        return static_cast<std::size_t>(y) * static_cast<std::size_t>(width_) + static_cast<std::size_t>(x);
+    }
+};
+
+} // namespace
+
+// Long-distance queries on a large grid scattered with rectangular obstacles, by flat A* and by HPA* at two cluster
+// sizes: full paths, the abstract path with only its first hop refined, and the cost of repairing the abstract graph
+// after scattered terrain changes.
+void run_hpa()
+{
+    constexpr int side = 8192;
+    constexpr int query_count = 20;
+    constexpr int edit_count = 200;
+
+    std::mt19937 random{3};
+    std::vector<std::uint8_t> walkable(static_cast<std::size_t>(side) * side, 1);
+    std::uniform_int_distribution<int> position{0, side - 1};
+    std::uniform_int_distribution<int> extent{2, 40};
+    for (int i = 0; i < side * side / 2000; ++i) {
+        const int x0 = position(random);
+        const int y0 = position(random);
+        const int x1 = std::min(x0 + extent(random), side);
+        const int y1 = std::min(y0 + extent(random), side);
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                walkable[static_cast<std::size_t>(y) * side + static_cast<std::size_t>(x)] = 0;
+            }
+        }
+    }
+    const auto open_cell = [&] {
+        for (;;) {
+            const Vec2<int> cell(position(random), position(random));
+            if (walkable[static_cast<std::size_t>(cell.y()) * side + static_cast<std::size_t>(cell.x())] != 0) {
+                return cell;
+            }
+        }
+    };
+    // Start and goal in opposite quarters, so every query crosses most of the grid.
+    std::vector<std::pair<Vec2<int>, Vec2<int>>> queries;
+    while (queries.size() < query_count) {
+        const Vec2<int> start = open_cell();
+        const Vec2<int> goal = open_cell();
+        if (Vec2<int>::manhattan_distance(start, goal) > side) {
+            queries.emplace_back(start, goal);
+        }
+    }
+
+    FlatAStar flat{side, side, walkable};
+    std::vector<int> flat_lengths;
+    const double flat_ms = best_milliseconds(1, [&] {
+        for (const auto& [start, goal] : queries) {
+            flat_lengths.push_back(flat.find_path(start, goal));
+        }
+    });
+    std::printf("%dx%d grid, %d queries\n", side, side, query_count);
+    std::printf("  flat A* query            %9.2f ms\n", flat_ms / query_count);
+
+    // Larger clusters shrink the abstract graph, and with it the search before the first step, but make every
+    // in-cluster search and repair dearer.
+    for (const int cluster_size : {32, 128}) {
+        std::optional<HierarchicalPathfinder> hierarchical;
+        const double build_ms =
+            best_milliseconds(1, [&] { hierarchical.emplace(side, side, walkable, cluster_size); });
+
+        std::vector<Vec2<int>> path;
+        double length_ratio = 0;
+        std::size_t found = 0;
+        const double query_ms = best_milliseconds(1, [&] {
+            for (std::size_t i = 0; i < queries.size(); ++i) {
+                if (hierarchical->find_path(queries[i].first, queries[i].second, path) && flat_lengths[i] > 0) {
+                    length_ratio += static_cast<double>(path.size() - 1) / flat_lengths[i];
+                    ++found;
+                }
+            }
+        });
+
+        // What a unit about to move needs: the abstract path and the cells of its first hop.
+        std::vector<Vec2<int>> hops;
+        std::vector<Vec2<int>> segment;
+        const double first_hop_ms = best_milliseconds(1, [&] {
+            for (const auto& [start, goal] : queries) {
+                if (hierarchical->find_abstract_path(start, goal, hops) && hops.size() > 1) {
+                    (void)hierarchical->refine_hop(hops[0], hops[1], segment);
+                }
+            }
+        });
+
+        std::mt19937 edits{5};
+        for (int i = 0; i < edit_count; ++i) {
+            hierarchical->set_walkable(Vec2<int>(position(edits), position(edits)), edits() % 2 == 0);
+        }
+        const double repair_ms = best_milliseconds(1, [&] { hierarchical->repair(); });
+
+        std::printf("  HPA*, %3d-cell clusters, %zu abstract nodes\n", cluster_size, hierarchical->node_count());
+        std::printf("    build                  %9.2f ms\n", build_ms);
+        std::printf("    query                  %9.2f ms  (paths %.3fx optimal)\n", query_ms / query_count,
+                    found > 0 ? length_ratio / static_cast<double>(found) : 0.0);
+        std::printf("    abstract path, 1st hop %9.2f ms\n", first_hop_ms / query_count);
+        std::printf("    repair, %d edits      %9.2f ms\n", edit_count, repair_ms);
+    }
+}
+
+} // namespace dm::benchmark
@@ -0,0 +1,55 @@
+#include "benchmark.h"
+
+#include <cstdio>
+
+#include <string_view>
+
+namespace {
+
+struct Suite
+{
+    std::string_view name;
+    void (*run)();
+};
+
+constexpr Suite suites[] = {
+    {"constraints", dm::benchmark::run_constraints},
+    {"orca", dm::benchmark::run_orca},
+    {"offset", dm::benchmark::run_offset},
+    {"polar", dm::benchmark::run_polar},
+    {"hpa", dm::benchmark::run_hpa},
+    {"tour", dm::benchmark::run_tour},
+    {"geodesy", dm::benchmark::run_geodesy},
+};
+
+} // namespace
+
+// Runs every suite, or only those named on the command line.
+int main(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        bool known = false;
+        for (const Suite& suite : suites) {
+            known = known || suite.name == argv[i];
+        }
+        if (!known) {
+            std::fprintf(stderr, "unknown suite '%s'; available:", argv[i]);
+            for (const Suite& suite : suites) {
+                std::fprintf(stderr, " %.*s", static_cast<int>(suite.name.size()), suite.name.data());
+            }
+            std::fprintf(stderr, "\n");
+            return 1;
+        }
+    }
+    for (const Suite& suite : suites) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; ++i) {
+            selected = selected || suite.name == argv[i];
+        }
+        if (selected) {
+            std::printf("== %.*s\n", static_cast<int>(suite.name.size()), suite.name.data());
+            suite.run();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "benchmark.h"
+
+#include "offset.h"
+#include "vec2.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <numbers>
+#include <optional>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace dm::benchmark {
+
+namespace {
+
+using Ring = std::vector<Vec2<std::int64_t>>;
+
+// A geofence-like outline in centimetres: a circle of 100 km radius with a wavy coastline of several scales and a
+// per-vertex jitter comparable to the vertex spacing, so that every offset creates many small loops to clean up.
+[[nodiscard]] Ring coastline(std::size_t vertex_count)
+{
+    constexpr double radius = 1e7;
+    const double spacing = 2 * std::numbers::pi * radius / static_cast<double>(vertex_count);
+    std::mt19937 random{1};
+    std::uniform_real_distribution<double> jitter{-spacing, spacing};
+    Ring ring;
+    ring.reserve(vertex_count);
+    for (std::size_t i = 0; i < vertex_count; ++i) {
+        const double angle = 2 * std::numbers::pi * static_cast<double>(i) / static_cast<double>(vertex_count);
+        const double r = radius * (1 + 0.05 * std::sin(7 * angle) + 0.01 * std::sin(131 * angle) +
+                                   0.002 * std::sin(2711 * angle)) +
+                         jitter(random);
+        ring.emplace_back(std::llround(r * std::cos(angle)), std::llround(r * std::sin(angle)));
+    }
+    return ring;
+}
+
+// A grid of square parcels with a courtyard hole each. Offsetting outward merges them into one region whose holes are
+// the courtyards and the small gaps left where four rounded corners meet.
+[[nodiscard]] std::vector<Ring> parcels(std::int64_t side)
+{
+    std::vector<Ring> rings;
+    for (std::int64_t row = 0; row < side; ++row) {
+        for (std::int64_t column = 0; column < side; ++column) {
+            const std::int64_t x = column * 3000;
+            const std::int64_t y = row * 3100;
+            rings.push_back(Ring{{x, y}, {x + 2900, y}, {x + 2900, y + 2900}, {x, y + 2900}});
+            rings.push_back(
+                Ring{{x + 1000, y + 1000}, {x + 1000, y + 1900}, {x + 1900, y + 1900}, {x + 1900, y + 1000}});
+        }
+    }
+    return rings;
+}
+
+[[nodiscard]] const char* join_name(JoinType join)
+{
+    switch (join) {
+    case JoinType::miter:
+        return "miter";
+    case JoinType::square:
+        return "square";
+    case JoinType::round:
+        return "round";
+    }
+    return "";
+}
+
+void report(const char* name, std::size_t input_vertices, double ms, const std::optional<std::vector<Ring>>& result)
+{
+    std::size_t output_vertices = 0;
+    for (const Ring& ring : result.value_or(std::vector<Ring>{})) {
+        output_vertices += ring.size();
+    }
+    std::printf("  %-22s %9.2f ms  %7.2f Mvertex/s  -> %zu rings, %zu vertices%s\n", name, ms,
+                static_cast<double>(input_vertices) / ms / 1e3, result ? result->size() : 0, output_vertices,
+                result ? "" : " (failed)");
+}
+
+} // namespace
+
+// Throughput of offsetting large outlines, in input vertices per second.
+void run_offset()
+{
+    constexpr int repeats = 3;
+    constexpr std::size_t vertex_count = 300000;
+    // 10 m in centimetres, a few vertex spacings.
+    constexpr double distance = 1000;
+
+    const Ring ring = coastline(vertex_count);
+    std::printf("coastline, %zu vertices, offset by +-%.0f\n", vertex_count, distance);
+    for (const JoinType join : {JoinType::miter, JoinType::square, JoinType::round}) {
+        PolygonOffsetter<std::int64_t> offsetter{{join, 2.0, 25.0}};
+        for (const double delta : {distance, -distance}) {
+            std::optional<std::vector<Ring>> result;
+            const double ms = best_milliseconds(repeats, [&] {
+                result = offsetter.offset_polygon(std::span<const Vec2<std::int64_t>>{ring}, delta);
+            });
+            char name[32];
+            std::snprintf(name, sizeof(name), "%s %s", join_name(join), delta > 0 ? "outward" : "inward");
+            report(name, ring.size(), ms, result);
+        }
+    }
+
+    const std::vector<Ring> grid = parcels(150);
+    std::printf("%zu parcels with holes, %zu vertices, offset by +100\n", grid.size() / 2, grid.size() * 4);
+    PolygonOffsetter<std::int64_t> offsetter{{JoinType::round, 2.0, 25.0}};
+    std::optional<std::vector<Ring>> result;
+    const double ms =
+        best_milliseconds(repeats, [&] { result = offsetter.offset_polygon(std::span<const Ring>{grid}, 100); });
+    report("round outward", grid.size() * 4, ms, result);
+}
+
+} // namespace dm::benchmark
@@ -0,0 +1,52 @@
+#include "benchmark.h"
+
+#include "orca.h"
+#include "vec2.h"
+
+#include <cstddef>
+#include <cstdio>
+
+#include <random>
+#include <vector>
+
+namespace dm::benchmark {
+
+// A dense crowd on a jittered grid in which neighbouring agents walk in opposite directions along x, checkerboard
+// fashion, so nearly every agent is on a collision course with the ones beside it. Reports one tick's throughput.
+void run_orca()
+{
+    constexpr std::size_t side = 224;
+    constexpr float spacing = 2;
+    constexpr float dt = 0.1F;
+    constexpr int repeats = 5;
+
+    std::vector<CrowdAgent<float>> agents;
+    agents.reserve(side * side);
+    std::mt19937 random{1};
+    std::uniform_real_distribution<float> jitter{-0.4F, 0.4F};
+    for (std::size_t row = 0; row < side; ++row) {
+        for (std::size_t column = 0; column < side; ++column) {
+            const Vec2<float> position(spacing * static_cast<float>(column) + jitter(random),
+                                       spacing * static_cast<float>(row) + jitter(random));
+            const Vec2<float> preferred((row + column) % 2 == 0 ? 1.5F : -1.5F, 0);
+            agents.push_back({position, preferred, preferred, 0.5F, 2});
+        }
+    }
+
+    std::vector<Vec2<float>> velocities(agents.size());
+    OrcaSolver<float> solver;
+    const double ms = best_milliseconds(repeats, [&] { solver.compute(agents, dt, velocities); });
+
+    // Fraction of agents that had to deviate from their preferred velocity, as a sanity check that the constraints
+    // were active.
+    std::size_t deviated = 0;
+    for (std::size_t i = 0; i < agents.size(); ++i) {
+        deviated += Vec2<float>::distance_squared(velocities[i], agents[i].preferred_velocity) > 1e-6F ? 1 : 0;
+    }
+    std::printf("%zu agents, %zu max neighbours\n", agents.size(), OrcaOptions{}.max_neighbors);
+    std::printf("  compute               %9.2f ms  %9.1f agents/ms  (%.0f%% deviated)\n", ms,
+                static_cast<double>(agents.size()) / ms,
+                100.0 * static_cast<double>(deviated) / static_cast<double>(agents.size()));
+}
+
+} // namespace dm::benchmark
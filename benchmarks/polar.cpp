@@ -0,0 +1,130 @@
+#include "benchmark.h"
+
+#include "fast_math.h"
+#include "polar.h"
+#include "vec2.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+
+#include <algorithm>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace dm::benchmark {
+
+namespace {
+
+// Largest deviations from libm, evaluated in double, over random arguments across each function's domain: atan2 of
+// coordinates spread over 2^-20 to 2^20 (with exact zeros mixed in), sincos within the reduced range of float or
+// double, and the square roots relative over 2^-60 to 2^60.
+template <Accuracy A, typename T>
+void report_errors(const char* name)
+{
+    constexpr int samples = 1 << 21;
+    constexpr double angle_range = sizeof(T) == sizeof(float) ? 100 : 1000;
+    std::mt19937_64 random{7};
+    std::uniform_real_distribution<double> unit{-1, 1};
+    std::uniform_real_distribution<double> exponent{-20, 20};
+    double atan2_error = 0;
+    double sin_cos_error = 0;
+    double rsqrt_error = 0;
+    double sqrt_error = 0;
+    for (int i = 0; i < samples; ++i) {
+        const double scale = std::exp2(exponent(random));
+        const auto y = (i % 11 == 0) ? T{0} : static_cast<T>(unit(random) * scale);
+        const auto x = (i % 7 == 0) ? T{0} : static_cast<T>(unit(random) * scale);
+        atan2_error = std::max(atan2_error, std::abs(double{fast_atan2<A>(y, x)} - std::atan2(double{y}, double{x})));
+
+        const auto angle = static_cast<T>(unit(random) * angle_range);
+        const auto [sine, cosine] = fast_sin_cos<A>(angle);
+        sin_cos_error = std::max({sin_cos_error, std::abs(double{sine} - std::sin(double{angle})),
+                                  std::abs(double{cosine} - std::cos(double{angle}))});
+
+        const auto value = static_cast<T>(std::exp2(3 * exponent(random)));
+        const double root = std::sqrt(double{value});
+        rsqrt_error = std::max(rsqrt_error, std::abs(double{fast_rsqrt<A>(value)} * root - 1));
+        sqrt_error = std::max(sqrt_error, std::abs(double{fast_sqrt<A>(value)} / root - 1));
+    }
+    std::printf("  %-14s %8.1e %8.1e %8.1e %8.1e\n", name, atan2_error, sin_cos_error, rsqrt_error, sqrt_error);
+}
+
+template <typename T>
+void report_timings(const char* type_name)
+{
+    constexpr std::size_t count = std::size_t{1} << 22;
+    constexpr int repeats = 5;
+    std::mt19937 random{1};
+    std::uniform_real_distribution<T> coordinate{-100, 100};
+    std::vector<Vec2<T>> points(count);
+    for (Vec2<T>& point : points) {
+        point = Vec2<T>(coordinate(random), coordinate(random));
+    }
+    std::vector<T> magnitudes(count);
+    std::vector<T> angles(count);
+    std::vector<Vec2<T>> output(count);
+
+    const auto row = [](const char* name, double libm_ms, double fast_ms) {
+        std::printf("  %-22s libm %8.2f ms  fast %8.2f ms  %5.2fx\n", name, libm_ms, fast_ms, libm_ms / fast_ms);
+    };
+    std::printf("%zu Vec2<%s>\n", count, type_name);
+
+    const double libm_to_polar = best_milliseconds(repeats, [&] {
+        for (std::size_t i = 0; i < count; ++i) {
+            magnitudes[i] = std::sqrt(points[i].x() * points[i].x() + points[i].y() * points[i].y());
+            angles[i] = std::atan2(points[i].y(), points[i].x());
+        }
+    });
+    const std::span<const Vec2<T>> input{points};
+    row("to_polar", libm_to_polar, best_milliseconds(repeats, [&] {
+            to_polar(input, std::span<T>{magnitudes}, std::span<T>{angles});
+        }));
+    row("to_polar (low)", libm_to_polar, best_milliseconds(repeats, [&] {
+            to_polar<Accuracy::low>(input, std::span<T>{magnitudes}, std::span<T>{angles});
+        }));
+
+    row("from_polar",
+        best_milliseconds(repeats, [&] {
+            for (std::size_t i = 0; i < count; ++i) {
+                output[i] = Vec2<T>(magnitudes[i] * std::cos(angles[i]), magnitudes[i] * std::sin(angles[i]));
+            }
+        }),
+        best_milliseconds(repeats, [&] {
+            from_polar(std::span<const T>{magnitudes}, std::span<const T>{angles}, std::span<Vec2<T>>{output});
+        }));
+
+    // Rotating in place would compound over the repeats, so each run starts again from the input points.
+    const auto reset = [&] { output = points; };
+    row("rotate by angles",
+        best_milliseconds(repeats, reset,
+                          [&] {
+                              for (std::size_t i = 0; i < count; ++i) {
+                                  const T sine = std::sin(angles[i]);
+                                  const T cosine = std::cos(angles[i]);
+                                  output[i] = Vec2<T>(output[i].x() * cosine - output[i].y() * sine,
+                                                      output[i].x() * sine + output[i].y() * cosine);
+                              }
+                          }),
+        best_milliseconds(repeats, reset, [&] { rotate(std::span<Vec2<T>>{output}, std::span<const T>{angles}); }));
+}
+
+} // namespace
+
+// Accuracy of the fast_math.h approximations behind polar.h, and the batch conversions against plain libm loops.
+// The batch functions use every hardware thread; the libm loops run on one.
+void run_polar()
+{
+    std::printf("max error vs libm  atan2    sincos   rsqrt    sqrt\n");
+    report_errors<Accuracy::low, double>("double low");
+    report_errors<Accuracy::medium, double>("double medium");
+    report_errors<Accuracy::high, double>("double high");
+    report_errors<Accuracy::low, float>("float low");
+    report_errors<Accuracy::medium, float>("float medium");
+    report_errors<Accuracy::high, float>("float high");
+    report_timings<float>("float");
+    report_timings<double>("double");
+}
+
+} // namespace dm::benchmark
@@ -0,0 +1,132 @@
+#include "benchmark.h"
+
+#include "tour.h"
+#include "vec2.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace dm::benchmark {
+
+namespace {
+
+[[nodiscard]] std::vector<Vec2<double>> random_stops(std::size_t count)
+{
+    std::mt19937 random{5};
+    std::uniform_real_distribution<double> coordinate{0, 1000};
+    std::vector<Vec2<double>> stops(count);
+    for (Vec2<double>& stop : stops) {
+        stop = Vec2<double>(coordinate(random), coordinate(random));
+    }
+    return stops;
+}
+
+// Greedy nearest-neighbour tour, the usual starting point for local search.
+[[nodiscard]] std::vector<std::uint32_t> nearest_neighbor_tour(std::span<const Vec2<double>> stops)
+{
+    std::vector<std::uint32_t> tour{0};
+    std::vector<bool> visited(stops.size());
+    visited[0] = true;
+    while (tour.size() < stops.size()) {
+        const Vec2<double>& last = stops[tour.back()];
+        std::uint32_t best = 0;
+        double best_distance = std::numeric_limits<double>::infinity();
+        for (std::uint32_t i = 0; i < stops.size(); ++i) {
+            const double distance = Vec2<double>::distance_squared(last, stops[i]);
+            if (!visited[i] && distance < best_distance) {
+                best = i;
+                best_distance = distance;
+            }
+        }
+        visited[best] = true;
+        tour.push_back(best);
+    }
+    return tour;
+}
+
+// 2-opt over the full O(n^2) neighbourhood, taking the first improving move, until none is left; the approach the
+// candidate-list search replaces.
+void full_two_opt(std::span<const Vec2<double>> stops, std::vector<std::uint32_t>& tour)
+{
+    const std::size_t n = tour.size();
+    const auto distance = [&](std::size_t a, std::size_t b) {
+        return Vec2<double>::distance(stops[tour[a]], stops[tour[b]]);
+    };
+    for (bool improved = true; improved;) {
+        improved = false;
+        for (std::size_t i = 0; i + 2 < n; ++i) {
+            for (std::size_t j = i + 2; j < n && !(i == 0 && j == n - 1); ++j) {
+                const std::size_t next_j = (j + 1) % n;
+                const double gain = distance(i, i + 1) + distance(j, next_j) - distance(i, j) - distance(i + 1, next_j);
+                if (gain > 1e-10) {
+                    std::reverse(tour.begin() + static_cast<std::ptrdiff_t>(i + 1),
+                                 tour.begin() + static_cast<std::ptrdiff_t>(j + 1));
+                    improved = true;
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+// Tour improvement from a nearest-neighbour start: candidate-list 2-opt and Or-opt against full-neighbourhood 2-opt
+// on a few thousand stops, then time-budgeted runs on a large instance.
+void run_tour()
+{
+    {
+        constexpr std::size_t count = 3000;
+        const std::vector<Vec2<double>> stops = random_stops(count);
+        const std::vector<std::uint32_t> start = nearest_neighbor_tour(stops);
+        std::vector<std::uint32_t> tour;
+        const auto reset = [&] { tour = start; };
+
+        const TourImprover<double> improver{stops};
+        std::printf("%zu stops, nearest-neighbour start %.1f\n", count, improver.length(start));
+        const double full_ms = best_milliseconds(1, reset, [&] { full_two_opt(stops, tour); });
+        std::printf("  full 2-opt            %9.2f ms  length %.1f\n", full_ms, improver.length(tour));
+        TourImprover<double> two_opt{stops, {10, false}};
+        const double two_opt_ms = best_milliseconds(3, reset, [&] { two_opt.improve(tour); });
+        std::printf("  candidate 2-opt       %9.2f ms  length %.1f\n", two_opt_ms, improver.length(tour));
+        TourImprover<double> or_opt{stops};
+        const double or_opt_ms = best_milliseconds(3, reset, [&] { or_opt.improve(tour); });
+        std::printf("  candidate 2-opt+Or    %9.2f ms  length %.1f\n", or_opt_ms, improver.length(tour));
+    }
+
+    constexpr std::size_t count = 100000;
+    const std::vector<Vec2<double>> stops = random_stops(count);
+    // A nearest-neighbour start over this many stops would take longer than the search itself, so the large
+    // instance starts from the stops sorted into vertical strips instead.
+    std::vector<std::uint32_t> start(count);
+    for (std::uint32_t i = 0; i < count; ++i) {
+        start[i] = i;
+    }
+    const auto strip = [&](std::uint32_t stop) { return static_cast<int>(stops[stop].x() / 10); };
+    std::sort(start.begin(), start.end(), [&](std::uint32_t lhs, std::uint32_t rhs) {
+        if (strip(lhs) != strip(rhs)) {
+            return strip(lhs) < strip(rhs);
+        }
+        return (strip(lhs) % 2 == 0) ? stops[lhs].y() < stops[rhs].y() : stops[lhs].y() > stops[rhs].y();
+    });
+
+    const double build_ms = best_milliseconds(1, [&] { const TourImprover<double> improver{stops}; });
+    TourImprover<double> improver{stops};
+    std::printf("%zu stops, strip start %.1f, candidate lists built in %.2f ms\n", count, improver.length(start),
+                build_ms);
+    for (const int budget : {10, 100, 1000}) {
+        std::vector<std::uint32_t> tour = start;
+        const double ms =
+            best_milliseconds(1, [&] { improver.improve(tour, std::chrono::milliseconds{budget}); });
+        std::printf("  budget %5d ms        %9.2f ms  length %.1f\n", budget, ms, improver.length(tour));
+    }
+}
+
+} // namespace dm::benchmark
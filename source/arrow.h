@@ -0,0 +1,290 @@
+#pragma once
+
+#include "vec2.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <concepts>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// The Arrow C data interface, as specified by Apache Arrow. These definitions are ABI-stable and guarded by the
+// macro the specification prescribes, so they coexist with Arrow's own headers.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema
+{
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+    void (*release)(struct ArrowSchema*);
+    void* private_data;
+};
+
+struct ArrowArray
+{
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+    void (*release)(struct ArrowArray*);
+    void* private_data;
+};
+
+#endif
+
+namespace dm {
+
+// Zero-copy views of Arrow arrays of points, and exports of points as Arrow arrays, through the C data interface. Two
+// layouts are understood: FixedSizeList<float or double, 2>, whose values are interleaved exactly like Vec2<T>, and a
+// struct of two float or double columns. Arrays with nulls are rejected.
+
+template <typename T>
+concept ArrowFloat = std::same_as<T, float> || std::same_as<T, double>;
+
+// Points stored as separate x and y columns.
+template <typename T>
+class PointColumns
+{
+  public:
+    PointColumns() = default;
+
+    // Both columns must have the same size.
+    PointColumns(std::span<const T> x, std::span<const T> y) noexcept : x_{x}, y_{y}
+    {
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return x_.size();
+    }
+
+    [[nodiscard]] std::span<const T> x() const noexcept
+    {
+        return x_;
+    }
+
+    [[nodiscard]] std::span<const T> y() const noexcept
+    {
+        return y_;
+    }
+
+    [[nodiscard]] Vec2<T> operator[](std::size_t i) const noexcept
+    {
+        return Vec2<T>(x_[i], y_[i]);
+    }
+
+  private:
+    std::span<const T> x_;
+    std::span<const T> y_;
+};
+
+namespace detail {
+
+template <ArrowFloat T>
+inline constexpr std::string_view arrow_format = std::same_as<T, double> ? "g" : "f";
+
+// FixedSizeList<2> values are reinterpreted as points, which needs Vec2<T> to be exactly its two coordinates.
+template <ArrowFloat T>
+inline constexpr bool packed_points = sizeof(Vec2<T>) == 2 * sizeof(T) && std::is_trivially_copyable_v<Vec2<T>>;
+
+[[nodiscard]] inline bool has_format(const ArrowSchema& schema, std::string_view format) noexcept
+{
+    return schema.format != nullptr && schema.format == format;
+}
+
+[[nodiscard]] inline bool without_nulls(const ArrowArray& array) noexcept
+{
+    return array.null_count == 0 || (array.n_buffers > 0 && array.buffers[0] == nullptr);
+}
+
+// The values of a primitive float or double array from element `first` on, or null if it is not one or has fewer
+// than `first + count` elements.
+template <ArrowFloat T>
+[[nodiscard]] const T* arrow_values(const ArrowSchema& schema, const ArrowArray& array, std::int64_t first,
+                                    std::int64_t count) noexcept
+{
+    if (!has_format(schema, arrow_format<T>) || array.n_buffers != 2 || !without_nulls(array) ||
+        array.buffers[1] == nullptr || array.length < first + count) {
+        return nullptr;
+    }
+    const T* values = static_cast<const T*>(array.buffers[1]) + array.offset + first;
+    return reinterpret_cast<std::uintptr_t>(values) % alignof(T) == 0 ? values : nullptr;
+}
+
+// Everything an exported array and schema point into. Every exported struct, children included, holds a reference,
+// so consumers may release or move the children independently, as the specification allows.
+struct ArrowExport
+{
+    std::shared_ptr<const void> owner;
+    std::array<const void*, 1> buffers{};
+    std::array<std::array<const void*, 2>, 2> child_buffers{};
+    std::array<ArrowArray, 2> child_arrays{};
+    std::array<ArrowArray*, 2> child_array_pointers{};
+    std::array<ArrowSchema, 2> child_schemas{};
+    std::array<ArrowSchema*, 2> child_schema_pointers{};
+};
+
+template <typename Struct>
+void release_export(Struct* exported) noexcept
+{
+    for (std::int64_t i = 0; i < exported->n_children; ++i) {
+        if (exported->children[i]->release != nullptr) {
+            exported->children[i]->release(exported->children[i]);
+        }
+    }
+    delete static_cast<std::shared_ptr<ArrowExport>*>(exported->private_data);
+    exported->release = nullptr;
+}
+
+// Exports an array of `length` with one float or double child per entry of `values`, each of `child_length`.
+template <ArrowFloat T, std::size_t N>
+void export_arrow(std::shared_ptr<const void> owner, const char* format, std::int64_t length,
+                  const std::array<const char*, N>& names, const std::array<const T*, N>& values,
+                  std::int64_t child_length, ArrowSchema& schema, ArrowArray& array)
+{
+    const auto data = std::make_shared<ArrowExport>();
+    data->owner = std::move(owner);
+    for (std::size_t i = 0; i < N; ++i) {
+        data->child_buffers[i] = {nullptr, values[i]};
+        data->child_schemas[i] = {.format = arrow_format<T>.data(),
+                                  .name = names[i],
+                                  .metadata = nullptr,
+                                  .flags = 0,
+                                  .n_children = 0,
+                                  .children = nullptr,
+                                  .dictionary = nullptr,
+                                  .release = release_export<ArrowSchema>,
+                                  .private_data = new std::shared_ptr<ArrowExport>{data}};
+        data->child_arrays[i] = {.length = child_length,
+                                 .null_count = 0,
+                                 .offset = 0,
+                                 .n_buffers = 2,
+                                 .n_children = 0,
+                                 .buffers = data->child_buffers[i].data(),
+                                 .children = nullptr,
+                                 .dictionary = nullptr,
+                                 .release = release_export<ArrowArray>,
+                                 .private_data = new std::shared_ptr<ArrowExport>{data}};
+        data->child_schema_pointers[i] = &data->child_schemas[i];
+        data->child_array_pointers[i] = &data->child_arrays[i];
+    }
+    schema = {.format = format,
+              .name = "",
+              .metadata = nullptr,
+              .flags = 0,
+              .n_children = N,
+              .children = data->child_schema_pointers.data(),
+              .dictionary = nullptr,
+              .release = release_export<ArrowSchema>,
+              .private_data = new std::shared_ptr<ArrowExport>{data}};
+    array = {.length = length,
+             .null_count = 0,
+             .offset = 0,
+             .n_buffers = 1,
+             .n_children = N,
+             .buffers = data->buffers.data(),
+             .children = data->child_array_pointers.data(),
+             .dictionary = nullptr,
+             .release = release_export<ArrowArray>,
+             .private_data = new std::shared_ptr<ArrowExport>{data}};
+}
+
+} // namespace detail
+
+// The points of a FixedSizeList<2> array of float or double, without copying; empty if the array has another type or
+// contains nulls. The view is valid until the array is released.
+template <ArrowFloat T>
+[[nodiscard]] std::optional<std::span<const Vec2<T>>> arrow_points(const ArrowSchema& schema,
+                                                                   const ArrowArray& array) noexcept
+{
+    static_assert(detail::packed_points<T>);
+    if (!detail::has_format(schema, "+w:2") || schema.n_children != 1 || array.n_children != 1 ||
+        !detail::without_nulls(array)) {
+        return std::nullopt;
+    }
+    if (array.length == 0) {
+        return std::span<const Vec2<T>>{};
+    }
+    const T* values = detail::arrow_values<T>(*schema.children[0], *array.children[0], 2 * array.offset,
+                                                    2 * array.length);
+    if (values == nullptr) {
+        return std::nullopt;
+    }
+    return std::span{reinterpret_cast<const Vec2<T>*>(values), static_cast<std::size_t>(array.length)};
+}
+
+// The columns of a struct array of two float or double fields, taken as x and y in that order, without copying;
+// empty if the array has another type or contains nulls. The view is valid until the array is released.
+template <ArrowFloat T>
+[[nodiscard]] std::optional<PointColumns<T>> arrow_columns(const ArrowSchema& schema, const ArrowArray& array) noexcept
+{
+    if (!detail::has_format(schema, "+s") || schema.n_children != 2 || array.n_children != 2 ||
+        !detail::without_nulls(array)) {
+        return std::nullopt;
+    }
+    if (array.length == 0) {
+        return PointColumns<T>{};
+    }
+    const T* x = detail::arrow_values<T>(*schema.children[0], *array.children[0], array.offset, array.length);
+    const T* y = detail::arrow_values<T>(*schema.children[1], *array.children[1], array.offset, array.length);
+    if (x == nullptr || y == nullptr) {
+        return std::nullopt;
+    }
+    const auto size = static_cast<std::size_t>(array.length);
+    return PointColumns<T>{{x, size}, {y, size}};
+}
+
+// Exports `points` as a FixedSizeList<2> array without copying them. The points must stay alive and unchanged until
+// the consumer releases the array.
+template <ArrowFloat T>
+void export_arrow_points(std::span<const Vec2<T>> points, ArrowSchema& schema, ArrowArray& array)
+{
+    static_assert(detail::packed_points<T>);
+    const auto length = static_cast<std::int64_t>(points.size());
+    detail::export_arrow<T, 1>(nullptr, "+w:2", length, {"item"}, {reinterpret_cast<const T*>(points.data())},
+                               2 * length, schema, array);
+}
+
+// Exports `points` as a FixedSizeList<2> array, handing the vector over to the array rather than copying it.
+template <ArrowFloat T>
+void export_arrow_points(std::vector<Vec2<T>>&& points, ArrowSchema& schema, ArrowArray& array)
+{
+    static_assert(detail::packed_points<T>);
+    const auto owner = std::make_shared<std::vector<Vec2<T>>>(std::move(points));
+    const auto length = static_cast<std::int64_t>(owner->size());
+    detail::export_arrow<T, 1>(owner, "+w:2", length, {"item"}, {reinterpret_cast<const T*>(owner->data())},
+                               2 * length, schema, array);
+}
+
+// Exports two columns as a struct array with fields "x" and "y" without copying them. The columns must stay alive and
+// unchanged until the consumer releases the array.
+template <ArrowFloat T>
+void export_arrow_columns(const PointColumns<T>& columns, ArrowSchema& schema, ArrowArray& array)
+{
+    const auto length = static_cast<std::int64_t>(columns.size());
+    detail::export_arrow<T, 2>(nullptr, "+s", length, {"x", "y"}, {columns.x().data(), columns.y().data()}, length,
+                               schema, array);
+}
+
+} // namespace dm
@@ -0,0 +1,533 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "vec2.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define DM_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace dm {
+
+struct AsyncReaderOptions
+{
+    // Bytes per read, rounded up to a multiple of 4096, which keeps every read on a record boundary.
+    std::size_t buffer_bytes = std::size_t{4} << 20;
+    // Number of buffers. Reads in flight plus filled buffers not yet released never exceed it, so it bounds both the
+    // queue towards the consumers and the memory used.
+    std::size_t queue_depth = 8;
+    // Opens the files with O_DIRECT, bypassing the page cache; the buffers are aligned for it.
+    bool direct_io = false;
+    // Use io_uring when the kernel offers it; otherwise, or if this is false, `fallback_threads` threads issue
+    // blocking reads.
+    bool use_io_uring = true;
+    std::size_t fallback_threads = 4;
+};
+
+namespace detail {
+
+inline constexpr std::size_t read_alignment = 4096;
+
+struct AlignedDelete
+{
+    void operator()(std::byte* bytes) const noexcept
+    {
+        ::operator delete[](bytes, std::align_val_t{read_alignment});
+    }
+};
+
+using AlignedBuffer = std::unique_ptr<std::byte[], AlignedDelete>;
+
+// A read of `size` bytes at `offset` of a file into a buffer, of which `done` have arrived.
+struct ReadRequest
+{
+    std::size_t file = 0;
+    std::size_t offset = 0;
+    std::size_t size = 0;
+    std::size_t done = 0;
+    std::size_t buffer = 0;
+    iovec vector{};
+};
+
+#if defined(DM_HAS_IO_URING)
+
+// Just enough of io_uring, through the raw system calls, to keep vectored reads in flight and reap their completions.
+class IoUring
+{
+  public:
+    explicit IoUring(unsigned entries)
+    {
+        io_uring_params params{};
+        descriptor_ = FileDescriptor{static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params))};
+        if (descriptor_.get() < 0) {
+            return;
+        }
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+        }
+        sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+        cq_ring_ = single_mmap ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+        if (sq_ring_ == nullptr || cq_ring_ == nullptr || sqes_ == nullptr) {
+            unmap();
+            descriptor_ = FileDescriptor{};
+            return;
+        }
+        const auto field = [](void* ring, unsigned offset) {
+            return reinterpret_cast<unsigned*>(static_cast<std::byte*>(ring) + offset);
+        };
+        sq_tail_ = field(sq_ring_, params.sq_off.tail);
+        sq_head_ = field(sq_ring_, params.sq_off.head);
+        sq_mask_ = *field(sq_ring_, params.sq_off.ring_mask);
+        sq_entries_ = params.sq_entries;
+        sq_array_ = field(sq_ring_, params.sq_off.array);
+        cq_head_ = field(cq_ring_, params.cq_off.head);
+        cq_tail_ = field(cq_ring_, params.cq_off.tail);
+        cq_mask_ = *field(cq_ring_, params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(static_cast<std::byte*>(cq_ring_) + params.cq_off.cqes);
+    }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    ~IoUring()
+    {
+        unmap();
+    }
+
+    [[nodiscard]] bool valid() const noexcept
+    {
+        return descriptor_.get() >= 0;
+    }
+
+    // Queues a read; the iovec must stay alive until submit() has returned. False if the submission queue is full.
+    bool queue_read(int descriptor, const iovec& vector, std::size_t offset, std::uint64_t user_data) noexcept
+    {
+        const unsigned tail = *sq_tail_;
+        if (tail - std::atomic_ref{*sq_head_}.load(std::memory_order_acquire) == sq_entries_) {
+            return false;
+        }
+        const unsigned index = tail & sq_mask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READV;
+        sqe.fd = descriptor;
+        sqe.addr = reinterpret_cast<std::uint64_t>(&vector);
+        sqe.len = 1;
+        sqe.off = offset;
+        sqe.user_data = user_data;
+        sq_array_[index] = index;
+        std::atomic_ref{*sq_tail_}.store(tail + 1, std::memory_order_release);
+        ++queued_;
+        return true;
+    }
+
+    // Submits the queued reads and waits until at least `wait_for` completions are available.
+    void submit(unsigned wait_for)
+    {
+        for (;;) {
+            const long submitted = ::syscall(__NR_io_uring_enter, descriptor_.get(), queued_, wait_for,
+                                             wait_for > 0 ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+            if (submitted >= 0) {
+                queued_ -= static_cast<unsigned>(submitted);
+                if (queued_ == 0) {
+                    return;
+                }
+            } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+            }
+        }
+    }
+
+    // Calls handle(user_data, result) for every available completion.
+    template <typename Function>
+    void reap(Function&& handle)
+    {
+        unsigned head = *cq_head_;
+        const unsigned tail = std::atomic_ref{*cq_tail_}.load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            handle(cqe.user_data, cqe.res);
+        }
+        std::atomic_ref{*cq_head_}.store(head, std::memory_order_release);
+    }
+
+  private:
+    FileDescriptor descriptor_;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    io_uring_sqe* sqes_ = nullptr;
+    std::size_t sq_ring_size_ = 0;
+    std::size_t cq_ring_size_ = 0;
+    std::size_t sqes_size_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned queued_ = 0;
+
+    [[nodiscard]] void* map(std::size_t size, std::uint64_t offset) const noexcept
+    {
+        void* ring = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor_.get(),
+                            static_cast<off_t>(offset));
+        return ring == MAP_FAILED ? nullptr : ring;
+    }
+
+    void unmap() noexcept
+    {
+        if (sqes_ != nullptr) {
+            ::munmap(sqes_, sqes_size_);
+        }
+        if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+            ::munmap(cq_ring_, cq_ring_size_);
+        }
+        if (sq_ring_ != nullptr) {
+            ::munmap(sq_ring_, sq_ring_size_);
+        }
+        sq_ring_ = cq_ring_ = nullptr;
+        sqes_ = nullptr;
+    }
+};
+
+#endif
+
+} // namespace detail
+
+class AsyncFileReader;
+
+// A filled buffer handed out by AsyncFileReader, given back for reuse when the batch is destroyed. Batches must not
+// outlive their reader.
+class ReadBatch
+{
+  public:
+    ReadBatch(ReadBatch&& other) noexcept
+        : reader_{std::exchange(other.reader_, nullptr)}, request_{other.request_}, data_{other.data_}
+    {
+    }
+
+    ReadBatch& operator=(ReadBatch&& other) noexcept
+    {
+        std::swap(reader_, other.reader_);
+        std::swap(request_, other.request_);
+        std::swap(data_, other.data_);
+        return *this;
+    }
+
+    inline ~ReadBatch();
+
+    // Index of the file, in the order given to the reader.
+    [[nodiscard]] std::size_t file() const noexcept
+    {
+        return request_.file;
+    }
+
+    // Byte offset of the batch in its file.
+    [[nodiscard]] std::size_t offset() const noexcept
+    {
+        return request_.offset;
+    }
+
+    [[nodiscard]] std::span<const std::byte> bytes() const noexcept
+    {
+        return {data_, std::min(request_.done, request_.size)};
+    }
+
+    // The whole Vec2<T> records of the batch; the first is record offset() / sizeof(Vec2<T>) of the file.
+    template <typename T>
+    [[nodiscard]] std::span<const Vec2<T>> points() const noexcept
+    {
+        return {reinterpret_cast<const Vec2<T>*>(data_), bytes().size() / sizeof(Vec2<T>)};
+    }
+
+  private:
+    friend class AsyncFileReader;
+
+    ReadBatch(AsyncFileReader* reader, const detail::ReadRequest& request, const std::byte* data) noexcept
+        : reader_{reader}, request_{request}, data_{data}
+    {
+    }
+
+    AsyncFileReader* reader_;
+    detail::ReadRequest request_;
+    const std::byte* data_;
+};
+
+// Reads files of Vec2 records in the background, keeping up to queue_depth reads in flight, and hands the filled
+// buffers to any number of consumer threads. Disk latency overlaps with whatever the consumers do with each batch.
+// Batches arrive in the order their reads complete, which need not be file order. Failures throw std::system_error,
+// from the constructor or from next().
+class AsyncFileReader
+{
+  public:
+    explicit AsyncFileReader(std::span<const std::filesystem::path> paths, AsyncReaderOptions options = {})
+        : buffer_bytes_{(std::max<std::size_t>(options.buffer_bytes, 1) + detail::read_alignment - 1) /
+                        detail::read_alignment * detail::read_alignment}
+    {
+        for (const std::filesystem::path& path : paths) {
+            files_.push_back(open_file(path, O_RDONLY | (options.direct_io ? O_DIRECT : 0)));
+            struct stat status{};
+            if (::fstat(files_.back().get(), &status) != 0) {
+                throw std::system_error(errno, std::generic_category(), "fstat " + path.string());
+            }
+            sizes_.push_back(static_cast<std::size_t>(status.st_size));
+            ::posix_fadvise(files_.back().get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+        const std::size_t depth = std::max<std::size_t>(options.queue_depth, 1);
+        for (std::size_t i = 0; i < depth; ++i) {
+            buffers_.emplace_back(new (std::align_val_t{detail::read_alignment}) std::byte[buffer_bytes_]);
+            idle_.push_back(i);
+        }
+        requests_.resize(depth);
+
+#if defined(DM_HAS_IO_URING)
+        if (options.use_io_uring) {
+            auto ring = std::make_unique<detail::IoUring>(static_cast<unsigned>(depth));
+            if (ring->valid()) {
+                producers_ = 1;
+                uses_io_uring_ = true;
+                threads_.emplace_back([this, ring = std::move(ring)] { guarded([&] { read_with(*ring); }); });
+                return;
+            }
+        }
+#endif
+        // Counted before any thread starts, since threads that finish early decrement it.
+        const std::size_t threads = std::max<std::size_t>(options.fallback_threads, 1);
+        producers_ = threads;
+        for (std::size_t i = 0; i < threads; ++i) {
+            threads_.emplace_back([this] { guarded([&] { read_blocking(); }); });
+        }
+    }
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    // Stops issuing reads and waits for those in flight.
+    ~AsyncFileReader()
+    {
+        {
+            const std::lock_guard lock{mutex_};
+            stopping_ = true;
+        }
+        idle_ready_.notify_all();
+        threads_.clear();
+    }
+
+    // The next filled batch, waiting for one if none is ready; empty once every file has been read.
+    [[nodiscard]] std::optional<ReadBatch> next()
+    {
+        std::unique_lock lock{mutex_};
+        filled_ready_.wait(lock, [&] { return !filled_.empty() || producers_ == 0 || error_ != nullptr; });
+        if (error_ != nullptr) {
+            std::rethrow_exception(error_);
+        }
+        if (filled_.empty()) {
+            return std::nullopt;
+        }
+        const detail::ReadRequest request = filled_.front();
+        filled_.pop_front();
+        return ReadBatch{this, request, buffers_[request.buffer].get()};
+    }
+
+    [[nodiscard]] bool uses_io_uring() const noexcept
+    {
+        return uses_io_uring_;
+    }
+
+  private:
+    friend class ReadBatch;
+
+    std::vector<FileDescriptor> files_;
+    std::vector<std::size_t> sizes_;
+    std::size_t buffer_bytes_;
+    std::vector<detail::AlignedBuffer> buffers_;
+    std::vector<detail::ReadRequest> requests_;
+    std::size_t next_file_ = 0;
+    std::size_t next_offset_ = 0;
+    std::mutex mutex_;
+    std::condition_variable idle_ready_;
+    std::condition_variable filled_ready_;
+    std::vector<std::size_t> idle_;
+    std::deque<detail::ReadRequest> filled_;
+    std::size_t producers_ = 0;
+    bool stopping_ = false;
+    bool uses_io_uring_ = false;
+    std::exception_ptr error_;
+    // Last, so that the threads are joined before anything they use is destroyed.
+    std::vector<std::jthread> threads_;
+
+    template <typename Function>
+    void guarded(Function&& read) noexcept
+    {
+        try {
+            read();
+        } catch (...) {
+            const std::lock_guard lock{mutex_};
+            if (error_ == nullptr) {
+                error_ = std::current_exception();
+            }
+            stopping_ = true;
+        }
+        {
+            const std::lock_guard lock{mutex_};
+            --producers_;
+        }
+        idle_ready_.notify_all();
+        filled_ready_.notify_all();
+    }
+
+    // Pairs an idle buffer with the next stretch of the files, waiting for a buffer if `wait`. Empty when there is
+    // nothing left to read, when stopping, or when no buffer is idle and `wait` is false.
+    [[nodiscard]] std::optional<detail::ReadRequest> claim(bool wait)
+    {
+        std::unique_lock lock{mutex_};
+        // Checked before waiting too: once everything is claimed, the consumer may hold every buffer until the
+        // producers are done.
+        const auto exhausted = [&] {
+            while (next_file_ < files_.size() && next_offset_ >= sizes_[next_file_]) {
+                ++next_file_;
+                next_offset_ = 0;
+            }
+            return next_file_ == files_.size();
+        };
+        if (wait) {
+            idle_ready_.wait(lock, [&] { return !idle_.empty() || stopping_ || exhausted(); });
+        }
+        if (idle_.empty() || stopping_ || exhausted()) {
+            return std::nullopt;
+        }
+        detail::ReadRequest& request = requests_[idle_.back()];
+        request = {next_file_, next_offset_, std::min(buffer_bytes_, sizes_[next_file_] - next_offset_), 0,
+                   idle_.back()};
+        idle_.pop_back();
+        next_offset_ += request.size;
+        return request;
+    }
+
+    void publish(const detail::ReadRequest& request)
+    {
+        {
+            const std::lock_guard lock{mutex_};
+            filled_.push_back(request);
+        }
+        filled_ready_.notify_one();
+    }
+
+    void release(std::size_t buffer)
+    {
+        {
+            const std::lock_guard lock{mutex_};
+            idle_.push_back(buffer);
+        }
+        idle_ready_.notify_one();
+    }
+
+    // The whole aligned stretch of buffer still to fill; O_DIRECT needs aligned lengths even at the end of a file.
+    [[nodiscard]] std::span<std::byte> remaining(const detail::ReadRequest& request) const noexcept
+    {
+        return {buffers_[request.buffer].get() + request.done, buffer_bytes_ - request.done};
+    }
+
+    void read_blocking()
+    {
+        while (const std::optional<detail::ReadRequest> claimed = claim(true)) {
+            detail::ReadRequest request = *claimed;
+            request.done = read_at(files_[request.file].get(), remaining(request), request.offset);
+            publish(request);
+        }
+    }
+
+#if defined(DM_HAS_IO_URING)
+    void read_with(detail::IoUring& ring)
+    {
+        const auto queue = [&](detail::ReadRequest& request) {
+            const std::span<std::byte> buffer = remaining(request);
+            request.vector = {buffer.data(), buffer.size()};
+            ring.queue_read(files_[request.file].get(), request.vector, request.offset + request.done,
+                            request.buffer);
+        };
+        // Reads in flight never exceed the buffer count, which is the ring size, so queueing cannot fail.
+        std::size_t in_flight = 0;
+        for (;;) {
+            while (const std::optional<detail::ReadRequest> claimed = claim(in_flight == 0)) {
+                queue(requests_[claimed->buffer]);
+                ++in_flight;
+            }
+            if (in_flight == 0) {
+                return;
+            }
+            ring.submit(1);
+            std::error_code error;
+            ring.reap([&](std::uint64_t buffer, int result) {
+                detail::ReadRequest& request = requests_[buffer];
+                if (result < 0) {
+                    error.assign(-result, std::generic_category());
+                    --in_flight;
+                    release(request.buffer);
+                    return;
+                }
+                request.done += static_cast<std::size_t>(result);
+                if (result == 0 || request.done >= request.size) {
+                    --in_flight;
+                    publish(request);
+                } else {
+                    queue(request);
+                }
+            });
+            if (error) {
+                // Let the reads already in flight land before the error stops the reader.
+                for (; in_flight > 0; ring.submit(1)) {
+                    ring.reap([&](std::uint64_t, int) { --in_flight; });
+                }
+                throw std::system_error(error, "io_uring read");
+            }
+        }
+    }
+#endif
+};
+
+inline ReadBatch::~ReadBatch()
+{
+    if (reader_ != nullptr) {
+        reader_->release(request_.buffer);
+    }
+}
+
+} // namespace dm
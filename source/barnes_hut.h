@@ -0,0 +1,408 @@
+#pragma once
+
+#include "fast_math.h"
+#include "morton.h"
+#include "parallel.h"
+#include "vec2.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace dm {
+
+struct BarnesHutOptions
+{
+    // Opening angle: a cell of size s at distance d is treated as a point mass when s / d < theta.
+    double theta = 0.5;
+    double softening = 1e-3;
+    double gravitational_constant = 1.0;
+    std::uint32_t leaf_size = 16;
+};
+
+// Barnes-Hut approximation of the pairwise inverse-square field. The quadtree is rebuilt from scratch on every call
+// to build(): bodies are sorted by Morton code, which makes every cell a contiguous range of bodies, and the cells
+// four levels down are sorted and built as independent subtrees on all threads. Nodes are stored in depth-first
+// order together with their subtree size, so traversal is a single forward scan that skips accepted subtrees.
+template <typename T>
+class BarnesHut
+{
+  public:
+    explicit BarnesHut(BarnesHutOptions options = {}) noexcept : options_{options} {}
+
+    // Builds the tree over the given bodies. `masses` is either empty, for unit masses, or one mass per position.
+    void build(std::span<const Vec2<T>> positions, std::span<const T> masses = {})
+    {
+        const std::size_t n = positions.size();
+        x_.resize(n);
+        y_.resize(n);
+        mass_.resize(n);
+        order_.resize(n);
+        keys_.resize(n);
+        scratch_.resize(n);
+        nodes_.clear();
+        leaves_.clear();
+        if (n == 0) {
+            return;
+        }
+
+        const MortonQuantizer<T> quantizer = make_quantizer(positions);
+        parallel_for(n, parallel_grain, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                keys_[i] = {quantizer(positions[i]), static_cast<std::uint32_t>(i)};
+            }
+        });
+        partition_buckets();
+
+        parallel_for(bucket_count, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t bucket = begin; bucket < end; ++bucket) {
+                build_bucket(bucket, positions, masses);
+            }
+        });
+
+        splice(0, 0, root_size_);
+        for (std::size_t i = 0; i < nodes_.size(); ++i) {
+            if (nodes_[i].subtree_size == 1) {
+                leaves_.push_back(static_cast<std::uint32_t>(i));
+            }
+        }
+    }
+
+    // Accelerations of every body of the last build, in the order they were passed to build().
+    // The bodies of each leaf share one traversal, opened against the leaf's bounding box, and one interaction list.
+    void accelerations(std::span<Vec2<T>> output) const
+    {
+        parallel_for(leaves_.size(), 16, [&](std::size_t begin, std::size_t end) {
+            InteractionList list;
+            for (std::size_t leaf = begin; leaf < end; ++leaf) {
+                const Node& node = nodes_[leaves_[leaf]];
+                const auto [min_x, max_x] = std::minmax_element(x_.begin() + node.begin, x_.begin() + node.end);
+                const auto [min_y, max_y] = std::minmax_element(y_.begin() + node.begin, y_.begin() + node.end);
+                gather(*min_x, *min_y, *max_x, *max_y, list);
+                for (std::size_t i = node.begin; i < node.end; ++i) {
+                    if (order_[i] < output.size()) {
+                        output[order_[i]] = sum(list, x_[i], y_[i]);
+                    }
+                }
+            }
+        });
+    }
+
+    [[nodiscard]] Vec2<T> acceleration(const Vec2<T>& point) const
+    {
+        InteractionList list;
+        gather(point.x(), point.y(), point.x(), point.y(), list);
+        return sum(list, point.x(), point.y());
+    }
+
+    void compute(std::span<const Vec2<T>> positions, std::span<const T> masses, std::span<Vec2<T>> output)
+    {
+        build(positions, masses);
+        accelerations(output);
+    }
+
+  private:
+    struct Key
+    {
+        std::uint64_t code;
+        std::uint32_t index;
+    };
+
+    struct InteractionList
+    {
+        std::vector<T> x;
+        std::vector<T> y;
+        std::vector<T> mass;
+
+        void clear() noexcept
+        {
+            x.clear();
+            y.clear();
+            mass.clear();
+        }
+
+        void push_back(T point_x, T point_y, T point_mass)
+        {
+            x.push_back(point_x);
+            y.push_back(point_y);
+            mass.push_back(point_mass);
+        }
+    };
+
+    struct Node
+    {
+        T center_x;
+        T center_y;
+        T mass;
+        T size;
+        std::uint32_t begin;
+        std::uint32_t end;
+        std::uint32_t subtree_size;
+    };
+
+    static constexpr unsigned max_depth = 24;
+    static constexpr unsigned top_levels = 4;
+    static constexpr std::size_t bucket_count = std::size_t{1} << (2 * top_levels);
+    static constexpr unsigned bucket_shift = 2 * (max_depth - top_levels);
+    static constexpr std::size_t parallel_grain = 16384;
+    static constexpr std::size_t lanes = 8;
+
+    BarnesHutOptions options_;
+    double root_size_ = 0;
+    std::vector<T> x_;
+    std::vector<T> y_;
+    std::vector<T> mass_;
+    std::vector<std::uint32_t> order_;
+    std::vector<Key> keys_;
+    std::vector<Key> scratch_;
+    std::array<std::size_t, bucket_count + 1> bucket_offsets_{};
+    std::array<std::vector<Node>, bucket_count> bucket_nodes_;
+    std::vector<Node> nodes_;
+    std::vector<std::uint32_t> leaves_;
+
+    MortonQuantizer<T> make_quantizer(std::span<const Vec2<T>> positions)
+    {
+        const std::size_t chunks = (positions.size() + parallel_grain - 1) / parallel_grain;
+        std::vector<std::array<double, 4>> partial(chunks);
+        parallel_for(positions.size(), parallel_grain, [&](std::size_t begin, std::size_t end) {
+            std::array<double, 4> box{std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(),
+                                      -std::numeric_limits<double>::infinity(),
+                                      -std::numeric_limits<double>::infinity()};
+            for (std::size_t i = begin; i < end; ++i) {
+                box[0] = std::min<double>(box[0], positions[i].x());
+                box[1] = std::min<double>(box[1], positions[i].y());
+                box[2] = std::max<double>(box[2], positions[i].x());
+                box[3] = std::max<double>(box[3], positions[i].y());
+            }
+            partial[begin / parallel_grain] = box;
+        });
+        std::array<double, 4> box = partial[0];
+        for (const auto& part : partial) {
+            box = {std::min(box[0], part[0]), std::min(box[1], part[1]), std::max(box[2], part[2]),
+                   std::max(box[3], part[3])};
+        }
+        root_size_ = std::max(box[2] - box[0], box[3] - box[1]);
+        return {box[0], box[1], box[2], box[3], max_depth};
+    }
+
+    // Scatters the keys into the buckets given by their top 2 * top_levels code bits.
+    void partition_buckets()
+    {
+        bucket_offsets_.fill(0);
+        for (const Key& key : keys_) {
+            ++bucket_offsets_[(key.code >> bucket_shift) + 1];
+        }
+        for (std::size_t bucket = 0; bucket < bucket_count; ++bucket) {
+            bucket_offsets_[bucket + 1] += bucket_offsets_[bucket];
+        }
+        std::array<std::size_t, bucket_count> cursor;
+        std::copy_n(bucket_offsets_.begin(), bucket_count, cursor.begin());
+        for (const Key& key : keys_) {
+            scratch_[cursor[key.code >> bucket_shift]++] = key;
+        }
+        keys_.swap(scratch_);
+    }
+
+    // LSD radix sort of one bucket on the code bits below the bucket prefix, then gathers its bodies and builds its
+    // subtree.
+    void build_bucket(std::size_t bucket, std::span<const Vec2<T>> positions, std::span<const T> masses)
+    {
+        const std::size_t begin = bucket_offsets_[bucket];
+        const std::size_t end = bucket_offsets_[bucket + 1];
+        bucket_nodes_[bucket].clear();
+        if (begin == end) {
+            return;
+        }
+
+        Key* source = keys_.data() + begin;
+        Key* target = scratch_.data() + begin;
+        const std::size_t size = end - begin;
+        for (unsigned shift = 0; shift < bucket_shift; shift += 8) {
+            std::array<std::size_t, 256> counts{};
+            for (std::size_t i = 0; i < size; ++i) {
+                ++counts[(source[i].code >> shift) & 0xFF];
+            }
+            if (std::find(counts.begin(), counts.end(), size) != counts.end()) {
+                continue;
+            }
+            std::size_t offset = 0;
+            for (std::size_t& count : counts) {
+                offset += std::exchange(count, offset);
+            }
+            for (std::size_t i = 0; i < size; ++i) {
+                target[counts[(source[i].code >> shift) & 0xFF]++] = source[i];
+            }
+            std::swap(source, target);
+        }
+        if (source != keys_.data() + begin) {
+            std::copy_n(source, size, keys_.data() + begin);
+        }
+
+        for (std::size_t i = begin; i < end; ++i) {
+            const std::uint32_t index = keys_[i].index;
+            x_[i] = positions[index].x();
+            y_[i] = positions[index].y();
+            mass_[i] = masses.empty() ? T{1} : masses[index];
+            order_[i] = index;
+        }
+        build_node(bucket_nodes_[bucket], begin, end, top_levels, root_size_ / (1u << top_levels));
+    }
+
+    void build_node(std::vector<Node>& nodes, std::size_t begin, std::size_t end, unsigned level, double size)
+    {
+        const std::size_t index = nodes.size();
+        nodes.push_back({0, 0, 0, static_cast<T>(size), static_cast<std::uint32_t>(begin),
+                         static_cast<std::uint32_t>(end), 1});
+        if (end - begin <= options_.leaf_size || level == max_depth) {
+            aggregate_bodies(nodes[index]);
+            return;
+        }
+
+        const unsigned shift = 2 * (max_depth - level - 1);
+        std::size_t child_begin = begin;
+        for (std::uint64_t quadrant = 0; quadrant < 4; ++quadrant) {
+            const auto child_end = static_cast<std::size_t>(
+                std::partition_point(keys_.begin() + child_begin, keys_.begin() + end,
+                                     [&](const Key& key) { return ((key.code >> shift) & 3) <= quadrant; }) -
+                keys_.begin());
+            if (child_end > child_begin) {
+                build_node(nodes, child_begin, child_end, level + 1, size / 2);
+            }
+            child_begin = child_end;
+        }
+        aggregate_children(nodes, index);
+    }
+
+    // Links the top levels above the bucket subtrees. A node at `level` covers 4^(top_levels - level) buckets.
+    void splice(unsigned level, std::size_t first_bucket, double size)
+    {
+        const std::size_t span = std::size_t{1} << (2 * (top_levels - level));
+        const std::size_t begin = bucket_offsets_[first_bucket];
+        const std::size_t end = bucket_offsets_[first_bucket + span];
+        if (begin == end) {
+            return;
+        }
+        if (level == top_levels) {
+            nodes_.insert(nodes_.end(), bucket_nodes_[first_bucket].begin(), bucket_nodes_[first_bucket].end());
+            return;
+        }
+
+        const std::size_t index = nodes_.size();
+        nodes_.push_back({0, 0, 0, static_cast<T>(size), static_cast<std::uint32_t>(begin),
+                          static_cast<std::uint32_t>(end), 1});
+        for (std::size_t quadrant = 0; quadrant < 4; ++quadrant) {
+            splice(level + 1, first_bucket + quadrant * span / 4, size / 2);
+        }
+        aggregate_children(nodes_, index);
+    }
+
+    void aggregate_bodies(Node& node) const noexcept
+    {
+        double mass = 0;
+        double x = 0;
+        double y = 0;
+        for (std::size_t i = node.begin; i < node.end; ++i) {
+            mass += mass_[i];
+            x += static_cast<double>(mass_[i]) * x_[i];
+            y += static_cast<double>(mass_[i]) * y_[i];
+        }
+        set_center(node, mass, x, y);
+    }
+
+    void aggregate_children(std::vector<Node>& nodes, std::size_t index) const noexcept
+    {
+        double mass = 0;
+        double x = 0;
+        double y = 0;
+        for (std::size_t child = index + 1; child < nodes.size(); child += nodes[child].subtree_size) {
+            mass += nodes[child].mass;
+            x += static_cast<double>(nodes[child].mass) * nodes[child].center_x;
+            y += static_cast<double>(nodes[child].mass) * nodes[child].center_y;
+        }
+        nodes[index].subtree_size = static_cast<std::uint32_t>(nodes.size() - index);
+        set_center(nodes[index], mass, x, y);
+    }
+
+    void set_center(Node& node, double mass, double x, double y) const noexcept
+    {
+        node.mass = static_cast<T>(mass);
+        node.center_x = (mass != 0) ? static_cast<T>(x / mass) : x_[node.begin];
+        node.center_y = (mass != 0) ? static_cast<T>(y / mass) : y_[node.begin];
+    }
+
+    // Traverses the tree once for every point in a box: cells far enough from the whole box are added as point
+    // masses, bodies of the leaves that must be opened are added individually.
+    void gather(T min_x, T min_y, T max_x, T max_y, InteractionList& list) const
+    {
+        list.clear();
+        const T theta_squared = static_cast<T>(options_.theta * options_.theta);
+        for (std::size_t i = 0; i < nodes_.size();) {
+            const Node& node = nodes_[i];
+            const T dx = std::max({min_x - node.center_x, node.center_x - max_x, T{0}});
+            const T dy = std::max({min_y - node.center_y, node.center_y - max_y, T{0}});
+            if (node.size * node.size < theta_squared * (dx * dx + dy * dy)) {
+                list.push_back(node.center_x, node.center_y, node.mass);
+                i += node.subtree_size;
+            } else {
+                if (node.subtree_size == 1) {
+                    list.x.insert(list.x.end(), x_.begin() + node.begin, x_.begin() + node.end);
+                    list.y.insert(list.y.end(), y_.begin() + node.begin, y_.begin() + node.end);
+                    list.mass.insert(list.mass.end(), mass_.begin() + node.begin, mass_.begin() + node.end);
+                }
+                ++i;
+            }
+        }
+    }
+
+    [[nodiscard]] Vec2<T> sum(const InteractionList& list, T x, T y) const noexcept
+    {
+        const T softening_squared = static_cast<T>(options_.softening * options_.softening);
+        // Branch-free, and fast_rsqrt does not set errno as std::sqrt may, so the lane loop below vectorizes. The
+        // smallest root of a normal number, added to every radius, keeps the cube of the inverse finite without
+        // softening; a body's pull on itself is then zero because its offsets are.
+        const T floor = std::sqrt(std::numeric_limits<T>::min());
+        auto pull = [softening_squared, floor](T dx, T dy, T mass) {
+            const T inverse = fast_rsqrt(dx * dx + dy * dy + softening_squared + floor);
+            return mass * inverse * inverse * inverse;
+        };
+
+        // Fixed-width lanes so the loop vectorizes without reassociating a single accumulator.
+        std::array<T, lanes> lane_x{};
+        std::array<T, lanes> lane_y{};
+        const std::size_t size = list.x.size();
+        std::size_t j = 0;
+        for (; j + lanes <= size; j += lanes) {
+            for (std::size_t lane = 0; lane < lanes; ++lane) {
+                const T dx = list.x[j + lane] - x;
+                const T dy = list.y[j + lane] - y;
+                const T scale = pull(dx, dy, list.mass[j + lane]);
+                lane_x[lane] += scale * dx;
+                lane_y[lane] += scale * dy;
+            }
+        }
+        T ax = 0;
+        T ay = 0;
+        for (; j < size; ++j) {
+            const T dx = list.x[j] - x;
+            const T dy = list.y[j] - y;
+            const T scale = pull(dx, dy, list.mass[j]);
+            ax += scale * dx;
+            ay += scale * dy;
+        }
+        for (std::size_t lane = 0; lane < lanes; ++lane) {
+            ax += lane_x[lane];
+            ay += lane_y[lane];
+        }
+        const auto constant = static_cast<T>(options_.gravitational_constant);
+        return {constant * ax, constant * ay};
+    }
+};
+
+} // namespace dm
@@ -0,0 +1,241 @@
+#pragma once
+
+#include "convex_hull.h"
+#include "vec2.h"
+
+#include <cmath>
+#include <cstddef>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace dm {
+
+struct Circle
+{
+    Vec2<double> center;
+    double radius;
+
+    [[nodiscard]] constexpr bool contains(const Vec2<double>& point, double tolerance = 1e-9) const noexcept
+    {
+        return Vec2<double>::distance_squared(center, point) <= radius * radius * (1 + tolerance) + tolerance;
+    }
+};
+
+struct OrientedRectangle
+{
+    Vec2<double> center;
+    Vec2<double> axis;
+    Vec2<double> half_extents;
+
+    [[nodiscard]] constexpr double area() const noexcept
+    {
+        return 4 * half_extents.x() * half_extents.y();
+    }
+
+    [[nodiscard]] constexpr std::array<Vec2<double>, 4> corners() const noexcept
+    {
+        const Vec2<double> u = axis * half_extents.x();
+        const Vec2<double> v = Vec2<double>{-axis.y(), axis.x()} * half_extents.y();
+        return {center - u - v, center + u - v, center + u + v, center - u + v};
+    }
+};
+
+namespace detail {
+
+template <typename T>
+[[nodiscard]] constexpr Vec2<double> to_double(const Vec2<T>& value) noexcept
+{
+    return {static_cast<double>(value.x()), static_cast<double>(value.y())};
+}
+
+[[nodiscard]] constexpr double cross(const Vec2<double>& lhs, const Vec2<double>& rhs) noexcept
+{
+    return lhs.x() * rhs.y() - lhs.y() * rhs.x();
+}
+
+[[nodiscard]] constexpr double dot(const Vec2<double>& lhs, const Vec2<double>& rhs) noexcept
+{
+    return lhs.x() * rhs.x() + lhs.y() * rhs.y();
+}
+
+[[nodiscard]] inline Circle circle_from(const Vec2<double>& a, const Vec2<double>& b) noexcept
+{
+    const Vec2<double> center = (a + b) / 2;
+    return {center, Vec2<double>::distance(center, a)};
+}
+
+[[nodiscard]] inline Circle circle_from(const Vec2<double>& a, const Vec2<double>& b, const Vec2<double>& c) noexcept
+{
+    const Vec2<double> ab = b - a;
+    const Vec2<double> ac = c - a;
+    const double denominator = 2 * cross(ab, ac);
+    if (denominator == 0) {
+        const auto [first, second] = std::minmax({a, b, c});
+        return circle_from(first, second);
+    }
+    const Vec2<double> offset{(ac.y() * ab.magnitude_squared() - ab.y() * ac.magnitude_squared()) / denominator,
+                              (ab.x() * ac.magnitude_squared() - ac.x() * ab.magnitude_squared()) / denominator};
+    return {a + offset, offset.magnitude()};
+}
+
+template <typename T>
+[[nodiscard]] std::vector<Vec2<double>> hull_of(const std::vector<Vec2<T>>& hull)
+{
+    std::vector<Vec2<double>> points(hull.size());
+    std::transform(hull.cbegin(), hull.cend(), points.begin(), [](const Vec2<T>& point) { return to_double(point); });
+    return points;
+}
+
+} // namespace detail
+
+// Smallest circle containing every point: Welzl's algorithm in its iterative move-to-front form, run on the convex
+// hull in a fixed pseudo-random order so results are reproducible.
+template <typename Vec2Container>
+[[nodiscard]] std::optional<Circle> min_enclosing_circle(const Vec2Container& vec2s)
+{
+    std::vector<Vec2<double>> points = detail::hull_of(convex_hull(vec2s));
+    if (points.empty()) {
+        return {};
+    }
+    std::minstd_rand random(static_cast<std::minstd_rand::result_type>(points.size()));
+    std::shuffle(points.begin(), points.end(), random);
+
+    Circle circle{points[0], 0};
+    for (std::size_t i = 1; i < points.size(); ++i) {
+        if (circle.contains(points[i])) {
+            continue;
+        }
+        circle = {points[i], 0};
+        for (std::size_t j = 0; j < i; ++j) {
+            if (circle.contains(points[j])) {
+                continue;
+            }
+            circle = detail::circle_from(points[i], points[j]);
+            for (std::size_t k = 0; k < j; ++k) {
+                if (!circle.contains(points[k])) {
+                    circle = detail::circle_from(points[i], points[j], points[k]);
+                }
+            }
+        }
+    }
+    return circle;
+}
+
+// Farthest pair of points, found by rotating calipers over the hull.
+template <typename Vec2Container>
+[[nodiscard]] std::optional<std::pair<typename Vec2Container::value_type, typename Vec2Container::value_type>>
+diameter(const Vec2Container& vec2s)
+{
+    const auto hull = convex_hull(vec2s);
+    if (hull.empty()) {
+        return {};
+    }
+    const std::vector<Vec2<double>> points = detail::hull_of(hull);
+    const std::size_t n = points.size();
+    std::pair<std::size_t, std::size_t> best{0, n - 1};
+    double best_distance = Vec2<double>::distance_squared(points[0], points[n - 1]);
+    for (std::size_t i = 0, j = 1 % n; i < n; ++i) {
+        const Vec2<double> edge = points[(i + 1) % n] - points[i];
+        while (detail::cross(edge, points[(j + 1) % n] - points[j]) > 0) {
+            j = (j + 1) % n;
+        }
+        for (const std::size_t k : {i, (i + 1) % n}) {
+            const double distance = Vec2<double>::distance_squared(points[k], points[j]);
+            if (distance > best_distance) {
+                best_distance = distance;
+                best = {k, j};
+            }
+        }
+    }
+    return {{hull[best.first], hull[best.second]}};
+}
+
+// Minimum distance between two parallel lines enclosing every point.
+template <typename Vec2Container>
+[[nodiscard]] std::optional<double> width(const Vec2Container& vec2s)
+{
+    const std::vector<Vec2<double>> points = detail::hull_of(convex_hull(vec2s));
+    if (points.empty()) {
+        return {};
+    }
+    const std::size_t n = points.size();
+    if (n < 3) {
+        return 0.0;
+    }
+    double best = std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0, j = 1; i < n; ++i) {
+        const Vec2<double> edge = points[(i + 1) % n] - points[i];
+        while (detail::cross(edge, points[(j + 1) % n] - points[i]) > detail::cross(edge, points[j] - points[i])) {
+            j = (j + 1) % n;
+        }
+        best = std::min(best, detail::cross(edge, points[j] - points[i]) / edge.magnitude());
+    }
+    return best;
+}
+
+// Minimum-area enclosing rectangle. One of its sides is collinear with a hull edge, so rotating calipers that track
+// the extreme points along and across each edge visit every candidate in linear time.
+template <typename Vec2Container>
+[[nodiscard]] std::optional<OrientedRectangle> min_area_rectangle(const Vec2Container& vec2s)
+{
+    const std::vector<Vec2<double>> points = detail::hull_of(convex_hull(vec2s));
+    if (points.empty()) {
+        return {};
+    }
+    const std::size_t n = points.size();
+    if (n == 1) {
+        return OrientedRectangle{points[0], Vec2<double>::unit_x(), {0, 0}};
+    }
+    if (n == 2) {
+        const Vec2<double> axis = points[1] - points[0];
+        return OrientedRectangle{(points[0] + points[1]) / 2, axis / axis.magnitude(), {axis.magnitude() / 2, 0}};
+    }
+
+    auto advance = [&points, n](std::size_t index, auto&& key) {
+        while (key(points[(index + 1) % n]) > key(points[index])) {
+            index = (index + 1) % n;
+        }
+        return index;
+    };
+
+    std::optional<OrientedRectangle> best;
+    std::size_t right = 1;
+    std::size_t top = 1;
+    std::size_t left = 1;
+    for (std::size_t i = 0; i < n; ++i) {
+        const Vec2<double> origin = points[i];
+        Vec2<double> axis = points[(i + 1) % n] - origin;
+        axis /= axis.magnitude();
+        const Vec2<double> normal{-axis.y(), axis.x()};
+        auto along = [&](const Vec2<double>& point) { return detail::dot(point - origin, axis); };
+        auto across = [&](const Vec2<double>& point) { return detail::dot(point - origin, normal); };
+
+        right = advance(right, along);
+        if (i == 0) {
+            top = right;
+        }
+        top = advance(top, across);
+        if (i == 0) {
+            left = top;
+        }
+        left = advance(left, [&](const Vec2<double>& point) { return -along(point); });
+
+        const double min_along = along(points[left]);
+        const double max_along = along(points[right]);
+        const double height = across(points[top]);
+        const double area = (max_along - min_along) * height;
+        if (!best || area < best->area()) {
+            const Vec2<double> center = origin + axis * ((min_along + max_along) / 2) + normal * (height / 2);
+            best = OrientedRectangle{center, axis, {(max_along - min_along) / 2, height / 2}};
+        }
+    }
+    return best;
+}
+
+} // namespace dm
@@ -0,0 +1,346 @@
+#pragma once
+
+#include "fast_math.h"
+#include "geodesy.h"
+#include "morton.h"
+#include "parallel.h"
+#include "vec2.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <limits>
+#include <numbers>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dm {
+
+// Cell IDs of two Z-order grids over the globe, for (longitude, latitude) points in degrees:
+//
+// - Geohashes interleave longitude and latitude bits, longitude first, over the plate carrée. A geohash of
+//   `precision` characters is a 5 * precision bit integer whose base-32 digits are the characters.
+// - Quadkeys are the tile IDs of the Bing Maps tile system over Web Mercator: two bits per level, x in the lower bit
+//   of each pair and y counted from the north, so the quadkey digits are the base-4 digits of the integer.
+//
+// All cells of a grid share its bit count, so every cell inside a coarser cell has a code in one contiguous range;
+// covering a box with ranges of codes lets a store sorted by code answer box queries with range scans.
+
+// Range [first, last] of cell IDs, inclusive.
+struct CellRange
+{
+    std::uint64_t first;
+    std::uint64_t last;
+};
+
+inline constexpr int max_geohash_precision = 12;
+inline constexpr int max_quadkey_level = 30;
+
+namespace detail {
+
+inline constexpr std::string_view geohash_alphabet = "0123456789bcdefghjkmnpqrstuvwxyz";
+
+// Grid cell of a coordinate scaled to [0, 1), clamped to the grid.
+[[nodiscard]] inline std::uint32_t grid_cell(double unit, int bits) noexcept
+{
+    const double cells = static_cast<double>(std::uint32_t{1} << bits);
+    double cell = unit * cells;
+    cell = select(cell < 0, 0.0, select(cell > cells - 1, cells - 1, cell));
+    // Through int32 since the cell fits, which unlike a direct unsigned conversion vectorizes.
+    return static_cast<std::uint32_t>(static_cast<std::int32_t>(cell));
+}
+
+[[nodiscard]] inline double cell_origin(std::uint32_t cell, int bits) noexcept
+{
+    return static_cast<double>(static_cast<std::int32_t>(cell)) / static_cast<double>(std::uint32_t{1} << bits);
+}
+
+// Geohash bit layout: the longitude bit is the top one, so it takes the odd positions when the bit count is even.
+struct GeohashLayout
+{
+    int lon_bits;
+    int lat_bits;
+    int lon_shift;
+    int lat_shift;
+
+    explicit constexpr GeohashLayout(int precision) noexcept
+        : lon_bits{(5 * precision + 1) / 2}, lat_bits{5 * precision / 2}, lon_shift{1 - 5 * precision % 2},
+          lat_shift{5 * precision % 2}
+    {
+    }
+};
+
+[[nodiscard]] inline std::uint64_t geohash_encode(const Vec2<double>& lon_lat, const GeohashLayout& layout) noexcept
+{
+    const std::uint32_t lon = grid_cell((lon_lat.x() + 180) / 360, layout.lon_bits);
+    const std::uint32_t lat = grid_cell((lon_lat.y() + 90) / 180, layout.lat_bits);
+    return (spread_bits(lon) << layout.lon_shift) | (spread_bits(lat) << layout.lat_shift);
+}
+
+[[nodiscard]] inline std::pair<std::uint32_t, std::uint32_t> quadkey_tile(const Vec2<double>& lon_lat,
+                                                                          int level) noexcept
+{
+    constexpr double world = 2 * std::numbers::pi * web_mercator_radius;
+    const Vec2<double> xy = to_web_mercator<Accuracy::high>(lon_lat);
+    return {grid_cell(xy.x() / world + 0.5, level), grid_cell(0.5 - xy.y() / world, level)};
+}
+
+// Covers the cells [x.first, x.second] x [y.first, y.second] of a Z-order grid with `bits` bits per code, x taking
+// the positions with parity `x_shift`. Refines the cells crossing the edge of the box one bit at a time and stops
+// early, covering the crossing cells whole, when refining further would need more than `max_ranges` ranges.
+inline void cover(std::pair<std::uint32_t, std::uint32_t> x, std::pair<std::uint32_t, std::uint32_t> y, int bits,
+                  int x_shift, std::size_t max_ranges, std::vector<CellRange>& ranges)
+{
+    struct Cell
+    {
+        std::uint64_t prefix;
+        std::uint32_t x;
+        std::uint32_t y;
+    };
+
+    ranges.clear();
+    if (x.first > x.second || y.first > y.second) {
+        return;
+    }
+    max_ranges = std::max<std::size_t>(max_ranges, 1);
+    int x_bits = (bits + 1 - x_shift) / 2;
+    int y_bits = bits - x_bits;
+    std::vector<Cell> crossing{{0, 0, 0}};
+    std::vector<Cell> next;
+    std::vector<CellRange> found;
+    int depth = 0;
+    for (; depth < bits && !crossing.empty(); ++depth) {
+        // The bit at position `bits - depth - 1` halves the cells along one axis.
+        const bool splits_x = (bits - depth - 1) % 2 == x_shift;
+        (splits_x ? x_bits : y_bits) -= 1;
+        const std::uint32_t width = std::uint32_t{1} << x_bits;
+        const std::uint32_t height = std::uint32_t{1} << y_bits;
+        const int below = bits - depth - 1;
+        next.clear();
+        found.clear();
+        for (const Cell& cell : crossing) {
+            for (std::uint32_t half = 0; half < 2; ++half) {
+                const Cell child{(cell.prefix << 1) | half, cell.x + (splits_x ? half * width : 0),
+                                 cell.y + (splits_x ? 0 : half * height)};
+                const std::uint32_t x_last = child.x + width - 1;
+                const std::uint32_t y_last = child.y + height - 1;
+                if (x_last < x.first || child.x > x.second || y_last < y.first || child.y > y.second) {
+                    continue;
+                }
+                if (child.x >= x.first && x_last <= x.second && child.y >= y.first && y_last <= y.second) {
+                    found.push_back({child.prefix << below, ((child.prefix + 1) << below) - 1});
+                } else {
+                    next.push_back(child);
+                }
+            }
+        }
+        if (ranges.size() + found.size() + next.size() > max_ranges) {
+            break;
+        }
+        ranges.insert(ranges.end(), found.begin(), found.end());
+        crossing.swap(next);
+    }
+    for (const Cell& cell : crossing) {
+        ranges.push_back({cell.prefix << (bits - depth), ((cell.prefix + 1) << (bits - depth)) - 1});
+    }
+
+    std::sort(ranges.begin(), ranges.end(), [](const CellRange& lhs, const CellRange& rhs) {
+        return lhs.first < rhs.first;
+    });
+    std::size_t merged = 0;
+    for (std::size_t i = 1; i < ranges.size(); ++i) {
+        if (ranges[i].first == ranges[merged].last + 1) {
+            ranges[merged].last = ranges[i].last;
+        } else {
+            ranges[++merged] = ranges[i];
+        }
+    }
+    ranges.resize(ranges.empty() ? 0 : merged + 1);
+}
+
+// Cell (min corner, max corner) from its grid coordinates.
+[[nodiscard]] inline std::pair<Vec2<double>, Vec2<double>> geohash_cell_bounds(std::uint32_t lon, std::uint32_t lat,
+                                                                               const GeohashLayout& layout) noexcept
+{
+    return {Vec2<double>(cell_origin(lon, layout.lon_bits) * 360 - 180, cell_origin(lat, layout.lat_bits) * 180 - 90),
+            Vec2<double>(cell_origin(lon + 1, layout.lon_bits) * 360 - 180,
+                         cell_origin(lat + 1, layout.lat_bits) * 180 - 90)};
+}
+
+[[nodiscard]] inline std::pair<Vec2<double>, Vec2<double>> quadkey_cell_bounds(std::uint32_t x, std::uint32_t y,
+                                                                               int level) noexcept
+{
+    constexpr double world = 2 * std::numbers::pi * web_mercator_radius;
+    const Vec2<double> north_west = from_web_mercator<Accuracy::high>(
+        Vec2<double>((cell_origin(x, level) - 0.5) * world, (0.5 - cell_origin(y, level)) * world));
+    const Vec2<double> south_east = from_web_mercator<Accuracy::high>(
+        Vec2<double>((cell_origin(x + 1, level) - 0.5) * world, (0.5 - cell_origin(y + 1, level)) * world));
+    return {Vec2<double>(north_west.x(), south_east.y()), Vec2<double>(south_east.x(), north_west.y())};
+}
+
+template <typename Function>
+[[nodiscard]] std::string cell_string(std::uint64_t code, int digits, int bits_per_digit, Function&& digit)
+{
+    std::string text(static_cast<std::size_t>(digits), ' ');
+    const std::uint64_t mask = (std::uint64_t{1} << bits_per_digit) - 1;
+    for (int i = 0; i < digits; ++i) {
+        text[static_cast<std::size_t>(i)] = digit((code >> ((digits - 1 - i) * bits_per_digit)) & mask);
+    }
+    return text;
+}
+
+} // namespace detail
+
+[[nodiscard]] inline std::uint64_t geohash_encode(const Vec2<double>& lon_lat, int precision) noexcept
+{
+    return detail::geohash_encode(lon_lat, detail::GeohashLayout{precision});
+}
+
+// Geohash of each point, up to the shorter of `lon_lat` and `codes`.
+inline void geohash_encode(std::span<const Vec2<double>> lon_lat, int precision, std::span<std::uint64_t> codes)
+{
+    const detail::GeohashLayout layout{precision};
+    const std::size_t count = std::min(lon_lat.size(), codes.size());
+    parallel_for(count, detail::geodesy_grain, [=](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            codes[i] = detail::geohash_encode(lon_lat[i], layout);
+        }
+    });
+}
+
+// (min corner, max corner) of a geohash cell.
+[[nodiscard]] inline std::pair<Vec2<double>, Vec2<double>> geohash_bounds(std::uint64_t code, int precision) noexcept
+{
+    const detail::GeohashLayout layout{precision};
+    return detail::geohash_cell_bounds(compact_bits(code >> layout.lon_shift), compact_bits(code >> layout.lat_shift),
+                                       layout);
+}
+
+// Centre of each geohash cell, up to the shorter of `codes` and `lon_lat`.
+inline void geohash_decode(std::span<const std::uint64_t> codes, int precision, std::span<Vec2<double>> lon_lat)
+{
+    const detail::GeohashLayout layout{precision};
+    const std::size_t count = std::min(codes.size(), lon_lat.size());
+    parallel_for(count, detail::geodesy_grain, [=](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const auto [min, max] = detail::geohash_cell_bounds(compact_bits(codes[i] >> layout.lon_shift),
+                                                                compact_bits(codes[i] >> layout.lat_shift), layout);
+            lon_lat[i] = Vec2<double>((min.x() + max.x()) / 2, (min.y() + max.y()) / 2);
+        }
+    });
+}
+
+[[nodiscard]] inline std::string geohash_string(std::uint64_t code, int precision)
+{
+    return detail::cell_string(code, precision, 5, [](std::uint64_t digit) { return detail::geohash_alphabet[digit]; });
+}
+
+// Geohash of up to max_geohash_precision characters; its precision is the length of `text`.
+[[nodiscard]] inline std::optional<std::uint64_t> geohash_parse(std::string_view text) noexcept
+{
+    if (text.size() > max_geohash_precision) {
+        return std::nullopt;
+    }
+    std::uint64_t code = 0;
+    for (const char c : text) {
+        const std::size_t digit = detail::geohash_alphabet.find(c);
+        if (digit == std::string_view::npos) {
+            return std::nullopt;
+        }
+        code = (code << 5) | digit;
+    }
+    return code;
+}
+
+// Ranges of the geohashes of the cells that overlap `box`, a (min corner, max corner) pair such as extents() returns,
+// sorted and merged where adjacent. With more than `max_ranges` ranges needed, cells crossing the edge of the box are
+// covered whole at a coarser precision, so the ranges also take in some cells outside the box.
+inline void geohash_ranges(const std::pair<Vec2<double>, Vec2<double>>& box, int precision,
+                           std::vector<CellRange>& ranges,
+                           std::size_t max_ranges = std::numeric_limits<std::size_t>::max())
+{
+    const detail::GeohashLayout layout{precision};
+    const std::uint32_t min_lon = detail::grid_cell((box.first.x() + 180) / 360, layout.lon_bits);
+    const std::uint32_t max_lon = detail::grid_cell((box.second.x() + 180) / 360, layout.lon_bits);
+    const std::uint32_t min_lat = detail::grid_cell((box.first.y() + 90) / 180, layout.lat_bits);
+    const std::uint32_t max_lat = detail::grid_cell((box.second.y() + 90) / 180, layout.lat_bits);
+    detail::cover({min_lon, max_lon}, {min_lat, max_lat}, 5 * precision, layout.lon_shift, max_ranges, ranges);
+}
+
+[[nodiscard]] inline std::uint64_t quadkey_encode(const Vec2<double>& lon_lat, int level) noexcept
+{
+    const auto [x, y] = detail::quadkey_tile(lon_lat, level);
+    return spread_bits(x) | (spread_bits(y) << 1);
+}
+
+// Quadkey of each point, up to the shorter of `lon_lat` and `codes`.
+inline void quadkey_encode(std::span<const Vec2<double>> lon_lat, int level, std::span<std::uint64_t> codes)
+{
+    const std::size_t count = std::min(lon_lat.size(), codes.size());
+    parallel_for(count, detail::geodesy_grain, [=](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const auto [x, y] = detail::quadkey_tile(lon_lat[i], level);
+            codes[i] = spread_bits(x) | (spread_bits(y) << 1);
+        }
+    });
+}
+
+// (min corner, max corner) of a quadkey tile in longitude and latitude.
+[[nodiscard]] inline std::pair<Vec2<double>, Vec2<double>> quadkey_bounds(std::uint64_t code, int level) noexcept
+{
+    return detail::quadkey_cell_bounds(compact_bits(code), compact_bits(code >> 1), level);
+}
+
+// Centre of each quadkey tile, halfway between its edges in Web Mercator, up to the shorter of `codes` and `lon_lat`.
+inline void quadkey_decode(std::span<const std::uint64_t> codes, int level, std::span<Vec2<double>> lon_lat)
+{
+    constexpr double world = 2 * std::numbers::pi * web_mercator_radius;
+    const std::size_t count = std::min(codes.size(), lon_lat.size());
+    parallel_for(count, detail::geodesy_grain, [=](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const double x = detail::cell_origin(compact_bits(codes[i]), level);
+            const double y = detail::cell_origin(compact_bits(codes[i] >> 1), level);
+            const double half = detail::cell_origin(1, level + 1);
+            lon_lat[i] =
+                from_web_mercator<Accuracy::high>(Vec2<double>((x + half - 0.5) * world, (0.5 - y - half) * world));
+        }
+    });
+}
+
+[[nodiscard]] inline std::string quadkey_string(std::uint64_t code, int level)
+{
+    return detail::cell_string(code, level, 2, [](std::uint64_t digit) { return static_cast<char>('0' + digit); });
+}
+
+// Quadkey of up to max_quadkey_level digits; its level is the length of `text`.
+[[nodiscard]] inline std::optional<std::uint64_t> quadkey_parse(std::string_view text) noexcept
+{
+    if (text.size() > max_quadkey_level) {
+        return std::nullopt;
+    }
+    std::uint64_t code = 0;
+    for (const char c : text) {
+        if (c < '0' || c > '3') {
+            return std::nullopt;
+        }
+        code = (code << 2) | static_cast<std::uint64_t>(c - '0');
+    }
+    return code;
+}
+
+// Ranges of the quadkeys of the tiles that overlap `box`, as for geohash_ranges(). Latitudes beyond the Web Mercator
+// limit fall in the first or last row of tiles.
+inline void quadkey_ranges(const std::pair<Vec2<double>, Vec2<double>>& box, int level, std::vector<CellRange>& ranges,
+                           std::size_t max_ranges = std::numeric_limits<std::size_t>::max())
+{
+    const auto [min_x, max_y] = detail::quadkey_tile(box.first, level);
+    const auto [max_x, min_y] = detail::quadkey_tile(box.second, level);
+    detail::cover({min_x, max_x}, {min_y, max_y}, 2 * level, 0, max_ranges, ranges);
+}
+
+} // namespace dm
@@ -0,0 +1,480 @@
+#pragma once
+
+#include "bounds.h"
+#include "vec2.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <span>
+
+namespace dm {
+
+// Convex polygon given by its counter-clockwise vertices, inflated by `radius`. One vertex with a radius is a
+// circle, two vertices with a radius a capsule.
+template <typename T>
+struct ConvexShape
+{
+    std::span<const Vec2<T>> vertices;
+    T radius = 0;
+};
+
+// Support vertices of the last GJK simplex, fed back into the next query of the same pair. Between frames the
+// simplex rarely changes, so a warm-started query usually terminates after one or two iterations.
+struct SimplexCache
+{
+    std::uint8_t count = 0;
+    std::array<std::uint32_t, 3> index_a{};
+    std::array<std::uint32_t, 3> index_b{};
+};
+
+// Signed distance between two shapes with closest (or deepest) points. `normal` points from a to b and `distance`
+// is negative when the shapes overlap.
+struct Contact
+{
+    bool colliding = false;
+    double distance = 0;
+    Vec2<double> normal;
+    Vec2<double> point_a;
+    Vec2<double> point_b;
+};
+
+template <typename T>
+struct ShapePair
+{
+    ConvexShape<T> a;
+    ConvexShape<T> b;
+};
+
+namespace detail {
+
+template <typename T>
+[[nodiscard]] constexpr Vec2<double> vertex(const ConvexShape<T>& shape, std::uint32_t index) noexcept
+{
+    return to_double(shape.vertices[index]);
+}
+
+template <typename T>
+[[nodiscard]] constexpr std::uint32_t support(const ConvexShape<T>& shape, const Vec2<double>& direction) noexcept
+{
+    std::uint32_t best = 0;
+    double best_value = dot(vertex(shape, 0), direction);
+    for (std::uint32_t i = 1; i < shape.vertices.size(); ++i) {
+        const double value = dot(vertex(shape, i), direction);
+        if (value > best_value) {
+            best = i;
+            best_value = value;
+        }
+    }
+    return best;
+}
+
+// Vertex of the Minkowski difference b - a.
+struct SimplexVertex
+{
+    Vec2<double> point_a;
+    Vec2<double> point_b;
+    Vec2<double> w;
+    double weight;
+    std::uint32_t index_a;
+    std::uint32_t index_b;
+};
+
+template <typename T>
+[[nodiscard]] constexpr SimplexVertex
+simplex_vertex(const ConvexShape<T>& a, const ConvexShape<T>& b, std::uint32_t index_a, std::uint32_t index_b) noexcept
+{
+    const Vec2<double> point_a = vertex(a, index_a);
+    const Vec2<double> point_b = vertex(b, index_b);
+    return {point_a, point_b, point_b - point_a, 1, index_a, index_b};
+}
+
+struct Simplex
+{
+    std::array<SimplexVertex, 3> vertices;
+    int count;
+
+    // Reduces the simplex to the feature closest to the origin and sets the barycentric weights.
+    constexpr void solve() noexcept
+    {
+        if (count == 2) {
+            solve_segment();
+        } else if (count == 3) {
+            solve_triangle();
+        }
+    }
+
+    [[nodiscard]] constexpr Vec2<double> search_direction() const noexcept
+    {
+        const Vec2<double>& w1 = vertices[0].w;
+        if (count == 1) {
+            return -w1;
+        }
+        const Vec2<double> edge = vertices[1].w - w1;
+        return (cross(edge, -w1) > 0) ? Vec2<double>{-edge.y(), edge.x()} : Vec2<double>{edge.y(), -edge.x()};
+    }
+
+    [[nodiscard]] constexpr std::pair<Vec2<double>, Vec2<double>> witness_points() const noexcept
+    {
+        Vec2<double> point_a;
+        Vec2<double> point_b;
+        for (int i = 0; i < count; ++i) {
+            point_a += vertices[i].weight * vertices[i].point_a;
+            point_b += vertices[i].weight * vertices[i].point_b;
+        }
+        return {point_a, (count == 3) ? point_a : point_b};
+    }
+
+  private:
+    constexpr void solve_segment() noexcept
+    {
+        const Vec2<double>& w1 = vertices[0].w;
+        const Vec2<double>& w2 = vertices[1].w;
+        const Vec2<double> e12 = w2 - w1;
+        const double d12_2 = -dot(w1, e12);
+        if (d12_2 <= 0) {
+            vertices[0].weight = 1;
+            count = 1;
+            return;
+        }
+        const double d12_1 = dot(w2, e12);
+        if (d12_1 <= 0) {
+            vertices[0] = vertices[1];
+            vertices[0].weight = 1;
+            count = 1;
+            return;
+        }
+        const double inverse = 1 / (d12_1 + d12_2);
+        vertices[0].weight = d12_1 * inverse;
+        vertices[1].weight = d12_2 * inverse;
+    }
+
+    constexpr void solve_triangle() noexcept
+    {
+        const Vec2<double>& w1 = vertices[0].w;
+        const Vec2<double>& w2 = vertices[1].w;
+        const Vec2<double>& w3 = vertices[2].w;
+
+        const Vec2<double> e12 = w2 - w1;
+        const double d12_1 = dot(w2, e12);
+        const double d12_2 = -dot(w1, e12);
+        const Vec2<double> e13 = w3 - w1;
+        const double d13_1 = dot(w3, e13);
+        const double d13_2 = -dot(w1, e13);
+        const Vec2<double> e23 = w3 - w2;
+        const double d23_1 = dot(w3, e23);
+        const double d23_2 = -dot(w2, e23);
+
+        const double n123 = cross(e12, e13);
+        const double d123_1 = n123 * cross(w2, w3);
+        const double d123_2 = n123 * cross(w3, w1);
+        const double d123_3 = n123 * cross(w1, w2);
+
+        auto keep_vertex = [this](int index) {
+            vertices[0] = vertices[index];
+            vertices[0].weight = 1;
+            count = 1;
+        };
+        auto keep_edge = [this](int first, int second, double first_weight, double second_weight) {
+            const double inverse = 1 / (first_weight + second_weight);
+            const SimplexVertex second_vertex = vertices[second];
+            vertices[0] = vertices[first];
+            vertices[1] = second_vertex;
+            vertices[0].weight = first_weight * inverse;
+            vertices[1].weight = second_weight * inverse;
+            count = 2;
+        };
+
+        if (d12_2 <= 0 && d13_2 <= 0) {
+            keep_vertex(0);
+        } else if (d12_1 > 0 && d12_2 > 0 && d123_3 <= 0) {
+            keep_edge(0, 1, d12_1, d12_2);
+        } else if (d13_1 > 0 && d13_2 > 0 && d123_2 <= 0) {
+            keep_edge(0, 2, d13_1, d13_2);
+        } else if (d12_1 <= 0 && d23_2 <= 0) {
+            keep_vertex(1);
+        } else if (d13_1 <= 0 && d23_1 <= 0) {
+            keep_vertex(2);
+        } else if (d23_1 > 0 && d23_2 > 0 && d123_1 <= 0) {
+            keep_edge(1, 2, d23_1, d23_2);
+        } else {
+            const double inverse = 1 / (d123_1 + d123_2 + d123_3);
+            vertices[0].weight = d123_1 * inverse;
+            vertices[1].weight = d123_2 * inverse;
+            vertices[2].weight = d123_3 * inverse;
+        }
+    }
+};
+
+inline constexpr int max_gjk_iterations = 32;
+inline constexpr int max_epa_vertices = 64;
+inline constexpr double epa_tolerance = 1e-9;
+
+// Closest features of the two polygons ignoring their radii (GJK, in the formulation of Box2D's b2Distance).
+template <typename T>
+[[nodiscard]] constexpr Simplex
+gjk(const ConvexShape<T>& a, const ConvexShape<T>& b, SimplexCache& cache) noexcept
+{
+    Simplex simplex{};
+    simplex.count = std::min<int>(cache.count, 3);
+    for (int i = 0; i < simplex.count; ++i) {
+        if (cache.index_a[i] >= a.vertices.size() || cache.index_b[i] >= b.vertices.size()) {
+            simplex.count = 0;
+            break;
+        }
+        simplex.vertices[i] = simplex_vertex(a, b, cache.index_a[i], cache.index_b[i]);
+    }
+    if (simplex.count == 0) {
+        simplex.vertices[0] = simplex_vertex(a, b, 0, 0);
+        simplex.count = 1;
+    }
+
+    for (int iteration = 0; iteration < max_gjk_iterations; ++iteration) {
+        std::array<std::uint32_t, 3> previous_a{};
+        std::array<std::uint32_t, 3> previous_b{};
+        const int previous_count = simplex.count;
+        for (int i = 0; i < previous_count; ++i) {
+            previous_a[i] = simplex.vertices[i].index_a;
+            previous_b[i] = simplex.vertices[i].index_b;
+        }
+
+        simplex.solve();
+        if (simplex.count == 3) {
+            break;
+        }
+        const Vec2<double> direction = simplex.search_direction();
+        constexpr double epsilon = std::numeric_limits<double>::epsilon();
+        if (dot(direction, direction) < epsilon * epsilon) {
+            break;
+        }
+
+        const SimplexVertex candidate = simplex_vertex(a, b, support(a, -direction), support(b, direction));
+        bool duplicate = false;
+        for (int i = 0; i < previous_count; ++i) {
+            duplicate = duplicate || (candidate.index_a == previous_a[i] && candidate.index_b == previous_b[i]);
+        }
+        if (duplicate) {
+            break;
+        }
+        simplex.vertices[simplex.count++] = candidate;
+    }
+
+    cache.count = static_cast<std::uint8_t>(simplex.count);
+    for (int i = 0; i < simplex.count; ++i) {
+        cache.index_a[i] = simplex.vertices[i].index_a;
+        cache.index_b[i] = simplex.vertices[i].index_b;
+    }
+    return simplex;
+}
+
+// Grows a simplex that ended on the origin (touching or barely overlapping shapes) into a triangle for EPA.
+template <typename T>
+constexpr void complete_simplex(const ConvexShape<T>& a, const ConvexShape<T>& b, Simplex& simplex) noexcept
+{
+    auto extend = [&](Vec2<double> direction, auto&& is_new) {
+        for (const Vec2<double> candidate_direction : {direction, -direction}) {
+            const SimplexVertex candidate =
+                simplex_vertex(a, b, support(a, -candidate_direction), support(b, candidate_direction));
+            if (is_new(candidate.w)) {
+                simplex.vertices[simplex.count++] = candidate;
+                return;
+            }
+        }
+        simplex.vertices[simplex.count] = simplex.vertices[simplex.count - 1];
+        ++simplex.count;
+    };
+    if (simplex.count == 1) {
+        extend(Vec2<double>::unit_x(), [&](const Vec2<double>& w) { return w != simplex.vertices[0].w; });
+    }
+    if (simplex.count == 2) {
+        const Vec2<double> edge = simplex.vertices[1].w - simplex.vertices[0].w;
+        extend(Vec2<double>{-edge.y(), edge.x()},
+               [&](const Vec2<double>& w) { return cross(edge, w - simplex.vertices[0].w) != 0; });
+    }
+}
+
+// Penetration of overlapping polygons: expands the GJK triangle towards the boundary of the Minkowski difference
+// until the face closest to the origin stops moving. Works on a fixed-size polytope, so it never allocates.
+template <typename T>
+[[nodiscard]] constexpr Contact epa(const ConvexShape<T>& a, const ConvexShape<T>& b, Simplex simplex) noexcept
+{
+    complete_simplex(a, b, simplex);
+    std::array<SimplexVertex, max_epa_vertices> polytope{};
+    std::copy_n(simplex.vertices.begin(), 3, polytope.begin());
+    int size = 3;
+    if (cross(polytope[1].w - polytope[0].w, polytope[2].w - polytope[0].w) < 0) {
+        std::swap(polytope[1], polytope[2]);
+    }
+
+    int closest = 0;
+    Vec2<double> normal;
+    double depth = 0;
+    for (;;) {
+        depth = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < size; ++i) {
+            const Vec2<double> edge = polytope[(i + 1) % size].w - polytope[i].w;
+            const double length = edge.magnitude();
+            if (length == 0) {
+                continue;
+            }
+            const Vec2<double> outward = Vec2<double>{edge.y(), -edge.x()} / length;
+            const double distance = dot(outward, polytope[i].w);
+            if (distance < depth) {
+                depth = distance;
+                normal = outward;
+                closest = i;
+            }
+        }
+        // Every edge has collapsed, as for two concentric circles: the origin is the only point there is, and any
+        // direction separates the shapes equally well.
+        if (depth == std::numeric_limits<double>::infinity()) {
+            depth = 0;
+            normal = Vec2<double>::unit_x();
+            closest = 0;
+            break;
+        }
+
+        const SimplexVertex candidate = simplex_vertex(a, b, support(a, -normal), support(b, normal));
+        if (size == max_epa_vertices || dot(candidate.w, normal) - depth <= epa_tolerance * (1 + depth)) {
+            break;
+        }
+        std::copy_backward(polytope.begin() + closest + 1, polytope.begin() + size, polytope.begin() + size + 1);
+        polytope[closest + 1] = candidate;
+        ++size;
+
+        // Simplex points from a cold or warm start need not be extreme, so the new point can leave one reflex.
+        for (int i = 0; i < size && size > 3;) {
+            const Vec2<double>& previous = polytope[(i + size - 1) % size].w;
+            const Vec2<double>& next = polytope[(i + 1) % size].w;
+            if (cross(polytope[i].w - previous, next - polytope[i].w) <= 0) {
+                std::copy(polytope.begin() + i + 1, polytope.begin() + size, polytope.begin() + i);
+                --size;
+                i = 0;
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    const SimplexVertex& first = polytope[closest];
+    const SimplexVertex& second = polytope[(closest + 1) % size];
+    const Vec2<double> edge = second.w - first.w;
+    const double length_squared = edge.magnitude_squared();
+    const double t = (length_squared > 0) ? std::clamp(-dot(first.w, edge) / length_squared, 0.0, 1.0) : 0.0;
+    return {true, -depth, -normal, first.point_a + t * (second.point_a - first.point_a),
+            first.point_b + t * (second.point_b - first.point_b)};
+}
+
+// Moves the contact from the polygons onto the surfaces of the shapes inflated by their radii.
+template <typename T>
+[[nodiscard]] constexpr Contact inflate(Contact contact, const ConvexShape<T>& a, const ConvexShape<T>& b) noexcept
+{
+    contact.point_a += static_cast<double>(a.radius) * contact.normal;
+    contact.point_b -= static_cast<double>(b.radius) * contact.normal;
+    contact.distance -= static_cast<double>(a.radius) + static_cast<double>(b.radius);
+    contact.colliding = contact.distance <= 0;
+    return contact;
+}
+
+} // namespace detail
+
+// GJK distance with EPA penetration depth for convex shapes with radii. `cache` carries the simplex between calls
+// for the same pair; a default-constructed cache starts cold.
+template <typename T>
+[[nodiscard]] constexpr Contact
+gjk_contact(const ConvexShape<T>& a, const ConvexShape<T>& b, SimplexCache& cache) noexcept
+{
+    if (a.vertices.empty() || b.vertices.empty()) {
+        return {};
+    }
+    const detail::Simplex simplex = detail::gjk(a, b, cache);
+
+    const auto [point_a, point_b] = simplex.witness_points();
+    const Vec2<double> delta = point_b - point_a;
+    const double distance = delta.magnitude();
+    if (simplex.count == 3 || distance == 0) {
+        return detail::inflate(detail::epa(a, b, simplex), a, b);
+    }
+    return detail::inflate(Contact{false, distance, delta / distance, point_a, point_b}, a, b);
+}
+
+template <typename T>
+[[nodiscard]] constexpr Contact gjk_contact(const ConvexShape<T>& a, const ConvexShape<T>& b) noexcept
+{
+    SimplexCache cache;
+    return gjk_contact(a, b, cache);
+}
+
+// Separating axis test over the edge normals of both polygons; cheaper than GJK for boxes and polygons with a handful
+// of vertices. Exact while the shapes overlap; for separated shapes `distance` is a lower bound on the gap.
+template <typename T>
+[[nodiscard]] constexpr Contact sat_contact(const ConvexShape<T>& a, const ConvexShape<T>& b) noexcept
+{
+    struct Axis
+    {
+        double separation = -std::numeric_limits<double>::infinity();
+        Vec2<double> normal;
+        Vec2<double> incident;
+    };
+    auto best_axis = [](const ConvexShape<T>& reference, const ConvexShape<T>& incident) {
+        Axis best;
+        const std::size_t n = reference.vertices.size();
+        for (std::size_t i = 0; i < n; ++i) {
+            const Vec2<double> origin = detail::vertex(reference, static_cast<std::uint32_t>(i));
+            const Vec2<double> edge = detail::vertex(reference, static_cast<std::uint32_t>((i + 1) % n)) - origin;
+            const double length = edge.magnitude();
+            if (length == 0) {
+                continue;
+            }
+            const Vec2<double> normal = Vec2<double>{edge.y(), -edge.x()} / length;
+            const Vec2<double> deepest = detail::vertex(incident, detail::support(incident, -normal));
+            const double separation = detail::dot(deepest - origin, normal);
+            if (separation > best.separation) {
+                best = {separation, normal, deepest};
+            }
+        }
+        return best;
+    };
+
+    if (a.vertices.size() < 3 || b.vertices.size() < 3) {
+        return gjk_contact(a, b);
+    }
+    const Axis on_a = best_axis(a, b);
+    const Axis on_b = best_axis(b, a);
+    if (on_a.separation >= on_b.separation) {
+        const Contact contact{false, on_a.separation, on_a.normal, on_a.incident - on_a.separation * on_a.normal,
+                              on_a.incident};
+        return detail::inflate(contact, a, b);
+    }
+    const Contact contact{false, on_b.separation, -on_b.normal, on_b.incident,
+                          on_b.incident - on_b.separation * on_b.normal};
+    return detail::inflate(contact, a, b);
+}
+
+// Narrowphase over many pairs. `caches` holds one warm-start cache per pair and is updated in place. The batch
+// functions are a convenience: each pair is still queried on its own, so they cost the same as a loop over
+// gjk_contact() or sat_contact(), and any saving comes from the warm starts.
+template <typename T>
+void gjk_contacts(std::span<const ShapePair<T>> pairs, std::span<SimplexCache> caches,
+                  std::span<Contact> contacts) noexcept
+{
+    const std::size_t count = std::min({pairs.size(), caches.size(), contacts.size()});
+    for (std::size_t i = 0; i < count; ++i) {
+        contacts[i] = gjk_contact(pairs[i].a, pairs[i].b, caches[i]);
+    }
+}
+
+template <typename T>
+void sat_contacts(std::span<const ShapePair<T>> pairs, std::span<Contact> contacts) noexcept
+{
+    const std::size_t count = std::min(pairs.size(), contacts.size());
+    for (std::size_t i = 0; i < count; ++i) {
+        contacts[i] = sat_contact(pairs[i].a, pairs[i].b);
+    }
+}
+
+} // namespace dm
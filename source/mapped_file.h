@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+
+#include <algorithm>
+#include <filesystem>
+#include <span>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dm {
+
+// Read-only mapping of part of a file; unmapped on destruction, which also drops its pages from the resident set.
+class MappedWindow
+{
+  public:
+    MappedWindow() = default;
+
+    MappedWindow(void* mapping, std::size_t mapping_size, std::size_t offset, std::size_t size) noexcept
+        : mapping_{mapping}, mapping_size_{mapping_size},
+          bytes_{static_cast<const std::byte*>(mapping) + offset, size}
+    {
+    }
+
+    MappedWindow(MappedWindow&& other) noexcept
+        : mapping_{std::exchange(other.mapping_, nullptr)}, mapping_size_{std::exchange(other.mapping_size_, 0)},
+          bytes_{std::exchange(other.bytes_, {})}
+    {
+    }
+
+    MappedWindow& operator=(MappedWindow&& other) noexcept
+    {
+        std::swap(mapping_, other.mapping_);
+        std::swap(mapping_size_, other.mapping_size_);
+        std::swap(bytes_, other.bytes_);
+        return *this;
+    }
+
+    ~MappedWindow()
+    {
+        if (mapping_ != nullptr) {
+            ::munmap(mapping_, mapping_size_);
+        }
+    }
+
+    [[nodiscard]] std::span<const std::byte> bytes() const noexcept
+    {
+        return bytes_;
+    }
+
+  private:
+    void* mapping_ = nullptr;
+    std::size_t mapping_size_ = 0;
+    std::span<const std::byte> bytes_;
+};
+
+// Owns a POSIX file descriptor and closes it on destruction.
+class FileDescriptor
+{
+  public:
+    FileDescriptor() = default;
+
+    explicit FileDescriptor(int descriptor) noexcept : descriptor_{descriptor}
+    {
+    }
+
+    FileDescriptor(FileDescriptor&& other) noexcept : descriptor_{std::exchange(other.descriptor_, -1)}
+    {
+    }
+
+    FileDescriptor& operator=(FileDescriptor&& other) noexcept
+    {
+        std::swap(descriptor_, other.descriptor_);
+        return *this;
+    }
+
+    ~FileDescriptor()
+    {
+        if (descriptor_ >= 0) {
+            ::close(descriptor_);
+        }
+    }
+
+    [[nodiscard]] int get() const noexcept
+    {
+        return descriptor_;
+    }
+
+  private:
+    int descriptor_ = -1;
+};
+
+// Opens `path` with the given open(2) flags, throwing std::system_error on failure.
+[[nodiscard]] inline FileDescriptor open_file(const std::filesystem::path& path, int flags, mode_t mode = 0644)
+{
+    const int descriptor = ::open(path.c_str(), flags | O_CLOEXEC, mode);
+    if (descriptor < 0) {
+        throw std::system_error(errno, std::generic_category(), "open " + path.string());
+    }
+    return FileDescriptor{descriptor};
+}
+
+// Writes all of `bytes` at the current file position, retrying short writes.
+inline void write_all(int descriptor, std::span<const std::byte> bytes)
+{
+    while (!bytes.empty()) {
+        const ssize_t written = ::write(descriptor, bytes.data(), bytes.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "write");
+        }
+        bytes = bytes.subspan(static_cast<std::size_t>(written));
+    }
+}
+
+// Reads into `bytes` from `offset` until it is full or the file ends; returns the number of bytes read.
+inline std::size_t read_at(int descriptor, std::span<std::byte> bytes, std::size_t offset)
+{
+    std::size_t total = 0;
+    while (total < bytes.size()) {
+        const ssize_t count = ::pread(descriptor, bytes.data() + total, bytes.size() - total,
+                                      static_cast<off_t>(offset + total));
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "pread");
+        }
+        if (count == 0) {
+            break;
+        }
+        total += static_cast<std::size_t>(count);
+    }
+    return total;
+}
+
+// A file opened for reading through mmap. Large files are meant to be read one window at a time, so that resident
+// memory stays bounded by the windows alive at once rather than by the file size. Failures throw std::system_error.
+class MappedFile
+{
+  public:
+    explicit MappedFile(const std::filesystem::path& path) : file_{open_file(path, O_RDONLY)}
+    {
+        struct stat status{};
+        if (::fstat(file_.get(), &status) != 0) {
+            throw std::system_error(errno, std::generic_category(), "fstat " + path.string());
+        }
+        size_ = static_cast<std::size_t>(status.st_size);
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    [[nodiscard]] int descriptor() const noexcept
+    {
+        return file_.get();
+    }
+
+    // Maps bytes [offset, offset + size) of the file, clipped to its end. The kernel is told the window will be read
+    // sequentially and soon, so it starts reading ahead right away; mapping the next window before processing the
+    // current one overlaps that I/O with the work.
+    [[nodiscard]] MappedWindow map(std::size_t offset, std::size_t size) const
+    {
+        offset = std::min(offset, size_);
+        size = std::min(size, size_ - offset);
+        if (size == 0) {
+            return {};
+        }
+        const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        const std::size_t start = offset - offset % page;
+        const std::size_t length = offset - start + size;
+        void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file_.get(), static_cast<off_t>(start));
+        if (mapping == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap");
+        }
+        ::madvise(mapping, length, MADV_SEQUENTIAL);
+        ::madvise(mapping, length, MADV_WILLNEED);
+        return {mapping, length, offset - start, size};
+    }
+
+  private:
+    FileDescriptor file_;
+    std::size_t size_ = 0;
+};
+
+} // namespace dm
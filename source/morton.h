@@ -0,0 +1,188 @@
+#pragma once
+
+#include "vec2.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace dm {
+
+[[nodiscard]] constexpr std::uint64_t spread_bits(std::uint32_t value) noexcept
+{
+    std::uint64_t bits = value;
+    bits = (bits | (bits << 16)) & 0x0000FFFF0000FFFFull;
+    bits = (bits | (bits << 8)) & 0x00FF00FF00FF00FFull;
+    bits = (bits | (bits << 4)) & 0x0F0F0F0F0F0F0F0Full;
+    bits = (bits | (bits << 2)) & 0x3333333333333333ull;
+    bits = (bits | (bits << 1)) & 0x5555555555555555ull;
+    return bits;
+}
+
+[[nodiscard]] constexpr std::uint32_t compact_bits(std::uint64_t bits) noexcept
+{
+    bits &= 0x5555555555555555ull;
+    bits = (bits | (bits >> 1)) & 0x3333333333333333ull;
+    bits = (bits | (bits >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+    bits = (bits | (bits >> 4)) & 0x00FF00FF00FF00FFull;
+    bits = (bits | (bits >> 8)) & 0x0000FFFF0000FFFFull;
+    bits = (bits | (bits >> 16)) & 0x00000000FFFFFFFFull;
+    return static_cast<std::uint32_t>(bits);
+}
+
+[[nodiscard]] constexpr std::uint64_t morton_encode(std::uint32_t x, std::uint32_t y) noexcept
+{
+#if defined(__BMI2__)
+    if (!std::is_constant_evaluated()) {
+        return _pdep_u64(x, 0x5555555555555555ull) | _pdep_u64(y, 0xAAAAAAAAAAAAAAAAull);
+    }
+#endif
+    return spread_bits(x) | (spread_bits(y) << 1);
+}
+
+[[nodiscard]] constexpr std::pair<std::uint32_t, std::uint32_t> morton_decode(std::uint64_t code) noexcept
+{
+#if defined(__BMI2__)
+    if (!std::is_constant_evaluated()) {
+        return {static_cast<std::uint32_t>(_pext_u64(code, 0x5555555555555555ull)),
+                static_cast<std::uint32_t>(_pext_u64(code, 0xAAAAAAAAAAAAAAAAull))};
+    }
+#endif
+    return {compact_bits(code), compact_bits(code >> 1)};
+}
+
+[[nodiscard]] constexpr bool morton_in_box(std::uint64_t code, std::uint64_t min_code, std::uint64_t max_code) noexcept
+{
+    constexpr std::uint64_t x_bits = 0x5555555555555555ull;
+    constexpr std::uint64_t y_bits = 0xAAAAAAAAAAAAAAAAull;
+    return (code & x_bits) >= (min_code & x_bits) && (code & x_bits) <= (max_code & x_bits) &&
+           (code & y_bits) >= (min_code & y_bits) && (code & y_bits) <= (max_code & y_bits);
+}
+
+// Smallest code greater than `code` whose cell lies in the box spanned by `min_code` and `max_code` (the BIGMIN of
+// Tropf and Herzog). Lets a scan over Morton-sorted keys jump past the stretches of the curve that leave the box.
+[[nodiscard]] constexpr std::uint64_t morton_next_in_box(std::uint64_t code, std::uint64_t min_code,
+                                                         std::uint64_t max_code) noexcept
+{
+    std::uint64_t next = max_code;
+    for (int bit = 63; bit >= 0; --bit) {
+        const std::uint64_t mask = std::uint64_t{1} << bit;
+        const std::uint64_t same_axis = (bit % 2 == 0) ? 0x5555555555555555ull : 0xAAAAAAAAAAAAAAAAull;
+        const std::uint64_t lower_same_axis = same_axis & (mask - 1);
+        const bool code_bit = (code & mask) != 0;
+        const bool min_bit = (min_code & mask) != 0;
+        const bool max_bit = (max_code & mask) != 0;
+        if (!code_bit && !min_bit && max_bit) {
+            next = (min_code | mask) & ~lower_same_axis;
+            max_code = (max_code & ~mask) | lower_same_axis;
+        } else if (!code_bit && min_bit && max_bit) {
+            return min_code;
+        } else if (code_bit && !min_bit && !max_bit) {
+            return next;
+        } else if (code_bit && !min_bit && max_bit) {
+            min_code = (min_code | mask) & ~lower_same_axis;
+        }
+    }
+    return next;
+}
+
+// Maps points inside a bounding box onto a 2^bits x 2^bits grid so that nearby points get nearby Morton codes.
+template <typename T>
+class MortonQuantizer
+{
+  public:
+    constexpr MortonQuantizer(double min_x, double min_y, double max_x, double max_y, unsigned bits = 32) noexcept
+        : min_x_{min_x}, min_y_{min_y}, max_cell_{static_cast<double>((bits >= 32) ? 0xFFFFFFFFu : ((1u << bits) - 1))}
+    {
+        double size = std::max(max_x - min_x, max_y - min_y);
+        scale_ = (size > 0) ? max_cell_ / size : 0.0;
+    }
+
+    constexpr MortonQuantizer(const std::pair<Vec2<T>, Vec2<T>>& bounds, unsigned bits = 32) noexcept
+        : MortonQuantizer(bounds.first.x(), bounds.first.y(), bounds.second.x(), bounds.second.y(), bits)
+    {}
+
+    [[nodiscard]] constexpr std::uint32_t cell_x(T x) const noexcept
+    {
+        return quantize(static_cast<double>(x) - min_x_);
+    }
+
+    [[nodiscard]] constexpr std::uint32_t cell_y(T y) const noexcept
+    {
+        return quantize(static_cast<double>(y) - min_y_);
+    }
+
+    [[nodiscard]] constexpr std::uint64_t operator()(T x, T y) const noexcept
+    {
+        return morton_encode(cell_x(x), cell_y(y));
+    }
+
+    [[nodiscard]] constexpr std::uint64_t operator()(const Vec2<T>& point) const noexcept
+    {
+        return (*this)(point.x(), point.y());
+    }
+
+  private:
+    double min_x_;
+    double min_y_;
+    double max_cell_;
+    double scale_;
+
+    [[nodiscard]] constexpr std::uint32_t quantize(double offset) const noexcept
+    {
+        double cell = offset * scale_;
+        cell = (cell < 0) ? 0 : ((cell > max_cell_) ? max_cell_ : cell);
+        return static_cast<std::uint32_t>(cell);
+    }
+};
+
+// Indices of `points` in Morton order over their bounding box, at 16 bits per axis, which is plenty to cluster
+// neighbouring points for cache locality. Sorted with an LSD radix sort on (code, index) pairs.
+template <typename T>
+[[nodiscard]] std::vector<std::uint32_t> morton_order(std::span<const Vec2<T>> points)
+{
+    std::vector<std::uint32_t> order(points.size());
+    if (points.empty()) {
+        return order;
+    }
+    const auto [min_x, max_x] =
+        std::minmax_element(points.begin(), points.end(), [](auto lhs, auto rhs) { return lhs.x() < rhs.x(); });
+    const auto [min_y, max_y] =
+        std::minmax_element(points.begin(), points.end(), [](auto lhs, auto rhs) { return lhs.y() < rhs.y(); });
+    const MortonQuantizer<T> quantizer(min_x->x(), min_y->y(), max_x->x(), max_y->y(), 16);
+
+    std::vector<std::uint64_t> keys(points.size());
+    std::vector<std::uint64_t> scratch(points.size());
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        keys[i] = (quantizer(points[i]) << 32) | i;
+    }
+    for (unsigned shift = 32; shift < 64; shift += 8) {
+        std::array<std::size_t, 257> offsets{};
+        for (const std::uint64_t key : keys) {
+            ++offsets[((key >> shift) & 0xFF) + 1];
+        }
+        for (std::size_t digit = 0; digit < 256; ++digit) {
+            offsets[digit + 1] += offsets[digit];
+        }
+        for (const std::uint64_t key : keys) {
+            scratch[offsets[(key >> shift) & 0xFF]++] = key;
+        }
+        keys.swap(scratch);
+    }
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        order[i] = static_cast<std::uint32_t>(keys[i]);
+    }
+    return order;
+}
+
+} // namespace dm
@@ -0,0 +1,408 @@
+#pragma once
+
+#include "triangulate.h"
+#include "vec2.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace dm {
+
+// Triangulated walkable area. Each polygon is triangulated on its own (keeping collinear vertices) and identical
+// vertices are welded, so polygons are connected wherever they share an edge with the same end points.
+template <typename T>
+class NavMesh
+{
+  public:
+    using index_type = std::uint32_t;
+    static constexpr index_type none = std::numeric_limits<index_type>::max();
+
+    explicit NavMesh(std::span<const std::vector<Vec2<T>>> polygons)
+    {
+        triangulate(polygons);
+        link_neighbors();
+        build_grid();
+    }
+
+    [[nodiscard]] std::size_t triangle_count() const noexcept
+    {
+        return triangles_.size();
+    }
+
+    [[nodiscard]] const Vec2<T>& vertex(index_type index) const noexcept
+    {
+        return vertices_[index];
+    }
+
+    // Counter-clockwise vertex indices of a triangle.
+    [[nodiscard]] const std::array<index_type, 3>& triangle(index_type index) const noexcept
+    {
+        return triangles_[index];
+    }
+
+    // Triangle across edge (triangle[edge], triangle[(edge + 1) % 3]), or none on the boundary.
+    [[nodiscard]] index_type neighbor(index_type index, std::size_t edge) const noexcept
+    {
+        return neighbors_[index][edge];
+    }
+
+    // Triangle containing `point` (boundary inclusive), found through the point-location grid.
+    [[nodiscard]] std::optional<index_type> locate(const Vec2<T>& point) const noexcept
+    {
+        if (triangles_.empty()) {
+            return {};
+        }
+        const double x = (static_cast<double>(point.x()) - min_x_) * inverse_cell_size_;
+        const double y = (static_cast<double>(point.y()) - min_y_) * inverse_cell_size_;
+        if (x < 0 || y < 0 || x >= static_cast<double>(columns_) || y >= static_cast<double>(rows_)) {
+            return {};
+        }
+        const std::size_t cell = static_cast<std::size_t>(y) * columns_ + static_cast<std::size_t>(x);
+        for (std::size_t i = cell_starts_[cell]; i < cell_starts_[cell + 1]; ++i) {
+            if (contains(cell_triangles_[i], point)) {
+                return cell_triangles_[i];
+            }
+        }
+        return {};
+    }
+
+    [[nodiscard]] bool contains(index_type index, const Vec2<T>& point) const noexcept
+    {
+        const auto& [a, b, c] = triangles_[index];
+        return cross(vertices_[a], vertices_[b], point) >= 0 && cross(vertices_[b], vertices_[c], point) >= 0 &&
+               cross(vertices_[c], vertices_[a], point) >= 0;
+    }
+
+  private:
+    std::vector<Vec2<T>> vertices_;
+    std::vector<std::array<index_type, 3>> triangles_;
+    std::vector<std::array<index_type, 3>> neighbors_;
+    double min_x_ = 0;
+    double min_y_ = 0;
+    double inverse_cell_size_ = 1;
+    std::size_t columns_ = 0;
+    std::size_t rows_ = 0;
+    std::vector<std::size_t> cell_starts_;
+    std::vector<index_type> cell_triangles_;
+
+    [[nodiscard]] static double cross(const Vec2<T>& a, const Vec2<T>& b, const Vec2<T>& c) noexcept
+    {
+        return (static_cast<double>(b.x()) - a.x()) * (static_cast<double>(c.y()) - a.y()) -
+               (static_cast<double>(b.y()) - a.y()) * (static_cast<double>(c.x()) - a.x());
+    }
+
+    void triangulate(std::span<const std::vector<Vec2<T>>> polygons)
+    {
+        Triangulator<T> triangulator;
+        std::vector<index_type> indices;
+        std::vector<std::pair<Vec2<T>, index_type>> corners;
+        for (const auto& polygon : polygons) {
+            indices.resize(Triangulator<T>::max_index_count(polygon.size()));
+            indices.resize(triangulator.monotone(polygon, indices));
+            for (const index_type index : indices) {
+                corners.emplace_back(polygon[index], static_cast<index_type>(corners.size()));
+            }
+        }
+
+        // Weld identical positions so that shared polygon edges become shared triangle edges.
+        std::sort(corners.begin(), corners.end());
+        std::vector<index_type> welded(corners.size());
+        for (std::size_t i = 0; i < corners.size(); ++i) {
+            if (i == 0 || corners[i].first != corners[i - 1].first) {
+                vertices_.push_back(corners[i].first);
+            }
+            welded[corners[i].second] = static_cast<index_type>(vertices_.size() - 1);
+        }
+        for (std::size_t i = 0; i + 2 < welded.size(); i += 3) {
+            std::array<index_type, 3> triangle{welded[i], welded[i + 1], welded[i + 2]};
+            const double area = cross(vertices_[triangle[0]], vertices_[triangle[1]], vertices_[triangle[2]]);
+            if (area == 0) {
+                continue;
+            }
+            if (area < 0) {
+                std::swap(triangle[1], triangle[2]);
+            }
+            triangles_.push_back(triangle);
+        }
+    }
+
+    // Pairs up directed edges (a, b) and (b, a) by sorting them on their undirected key.
+    void link_neighbors()
+    {
+        neighbors_.assign(triangles_.size(), {none, none, none});
+        std::vector<std::tuple<index_type, index_type, index_type, std::uint8_t>> edges;
+        edges.reserve(3 * triangles_.size());
+        for (std::size_t t = 0; t < triangles_.size(); ++t) {
+            for (std::uint8_t edge = 0; edge < 3; ++edge) {
+                const index_type a = triangles_[t][edge];
+                const index_type b = triangles_[t][(edge + 1) % 3];
+                edges.emplace_back(std::min(a, b), std::max(a, b), static_cast<index_type>(t), edge);
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        for (std::size_t i = 0; i + 1 < edges.size(); ++i) {
+            const auto& [a, b, first, first_edge] = edges[i];
+            const auto& [c, d, second, second_edge] = edges[i + 1];
+            if (a == c && b == d) {
+                neighbors_[first][first_edge] = second;
+                neighbors_[second][second_edge] = first;
+                ++i;
+            }
+        }
+    }
+
+    // Uniform grid of roughly one triangle per cell; each cell lists the triangles whose bounding box overlaps it.
+    void build_grid()
+    {
+        if (triangles_.empty()) {
+            return;
+        }
+        double max_x = vertices_[0].x();
+        double max_y = vertices_[0].y();
+        min_x_ = max_x;
+        min_y_ = max_y;
+        for (const auto& vertex : vertices_) {
+            min_x_ = std::min<double>(min_x_, vertex.x());
+            min_y_ = std::min<double>(min_y_, vertex.y());
+            max_x = std::max<double>(max_x, vertex.x());
+            max_y = std::max<double>(max_y, vertex.y());
+        }
+        const double width = max_x - min_x_;
+        const double height = max_y - min_y_;
+        const double cell_size =
+            std::max({std::sqrt(width * height / static_cast<double>(triangles_.size())),
+                      std::max(width, height) / 1024, std::numeric_limits<double>::min()});
+        inverse_cell_size_ = 1 / cell_size;
+        columns_ = static_cast<std::size_t>(width * inverse_cell_size_) + 1;
+        rows_ = static_cast<std::size_t>(height * inverse_cell_size_) + 1;
+
+        auto for_each_cell = [&](const std::array<index_type, 3>& triangle, auto&& function) {
+            const auto [low_x, high_x] = std::minmax({vertices_[triangle[0]].x(), vertices_[triangle[1]].x(),
+                                                       vertices_[triangle[2]].x()});
+            const auto [low_y, high_y] = std::minmax({vertices_[triangle[0]].y(), vertices_[triangle[1]].y(),
+                                                       vertices_[triangle[2]].y()});
+            const auto column = [&](double x) {
+                return std::min(columns_ - 1, static_cast<std::size_t>((x - min_x_) * inverse_cell_size_));
+            };
+            const auto row = [&](double y) {
+                return std::min(rows_ - 1, static_cast<std::size_t>((y - min_y_) * inverse_cell_size_));
+            };
+            for (std::size_t r = row(low_y); r <= row(high_y); ++r) {
+                for (std::size_t c = column(low_x); c <= column(high_x); ++c) {
+                    function(r * columns_ + c);
+                }
+            }
+        };
+
+        cell_starts_.assign(columns_ * rows_ + 1, 0);
+        for (const auto& triangle : triangles_) {
+            for_each_cell(triangle, [&](std::size_t cell) { ++cell_starts_[cell + 1]; });
+        }
+        for (std::size_t cell = 0; cell < columns_ * rows_; ++cell) {
+            cell_starts_[cell + 1] += cell_starts_[cell];
+        }
+        cell_triangles_.resize(cell_starts_.back());
+        std::vector<std::size_t> cursor(cell_starts_.begin(), cell_starts_.end() - 1);
+        for (std::size_t t = 0; t < triangles_.size(); ++t) {
+            for_each_cell(triangles_[t],
+                          [&](std::size_t cell) { cell_triangles_[cursor[cell]++] = static_cast<index_type>(t); });
+        }
+    }
+};
+
+// Path queries on a NavMesh: A* over triangles, measured between the midpoints of the portal edges they are entered
+// through, followed by string pulling with the simple stupid funnel algorithm. Search state is tagged with a query
+// generation instead of being cleared, so a query object reused across searches does not reallocate or reset.
+template <typename T>
+class NavMeshQuery
+{
+  public:
+    using index_type = typename NavMesh<T>::index_type;
+
+    // Writes the shortest corridor path from `start` to `goal` into `path`, both end points included. Returns false,
+    // leaving `path` empty, if either point is off the mesh or the goal cannot be reached.
+    bool find_path(const NavMesh<T>& mesh, const Vec2<T>& start, const Vec2<T>& goal, std::vector<Vec2<T>>& path)
+    {
+        path.clear();
+        const std::optional<index_type> first = mesh.locate(start);
+        const std::optional<index_type> last = mesh.locate(goal);
+        if (!first || !last || !search(mesh, *first, *last, start, goal)) {
+            return false;
+        }
+        collect_portals(mesh, start, goal);
+        string_pull(path);
+        return true;
+    }
+
+  private:
+    static constexpr index_type none = NavMesh<T>::none;
+
+    struct Record
+    {
+        std::uint32_t generation = 0;
+        bool closed = false;
+        index_type parent = none;
+        double cost = 0;
+        Vec2<double> entry;
+    };
+
+    std::vector<Record> records_;
+    std::uint32_t generation_ = 0;
+    std::vector<std::pair<double, index_type>> open_;
+    std::vector<index_type> corridor_;
+    std::vector<std::pair<Vec2<T>, Vec2<T>>> portals_;
+
+    [[nodiscard]] static Vec2<double> to_double(const Vec2<T>& point) noexcept
+    {
+        return {static_cast<double>(point.x()), static_cast<double>(point.y())};
+    }
+
+    bool search(const NavMesh<T>& mesh, index_type first, index_type last, const Vec2<T>& start, const Vec2<T>& goal)
+    {
+        if (records_.size() < mesh.triangle_count()) {
+            records_.resize(mesh.triangle_count());
+        }
+        if (++generation_ == 0) {
+            std::fill(records_.begin(), records_.end(), Record{});
+            generation_ = 1;
+        }
+        const Vec2<double> target = to_double(goal);
+        open_.clear();
+        records_[first] = {generation_, false, none, 0, to_double(start)};
+        open_.emplace_back(-Vec2<double>::distance(records_[first].entry, target), first);
+
+        while (!open_.empty()) {
+            std::pop_heap(open_.begin(), open_.end());
+            const index_type current = open_.back().second;
+            open_.pop_back();
+            Record& record = records_[current];
+            if (record.closed) {
+                continue;
+            }
+            record.closed = true;
+            if (current == last) {
+                corridor_.clear();
+                for (index_type t = last; t != none; t = records_[t].parent) {
+                    corridor_.push_back(t);
+                }
+                std::reverse(corridor_.begin(), corridor_.end());
+                return true;
+            }
+
+            for (std::size_t edge = 0; edge < 3; ++edge) {
+                const index_type next = mesh.neighbor(current, edge);
+                if (next == none) {
+                    continue;
+                }
+                Record& neighbor = records_[next];
+                if (neighbor.generation == generation_ && neighbor.closed) {
+                    continue;
+                }
+                const auto& triangle = mesh.triangle(current);
+                const Vec2<double> entry =
+                    (to_double(mesh.vertex(triangle[edge])) + to_double(mesh.vertex(triangle[(edge + 1) % 3]))) / 2;
+                const double cost = record.cost + Vec2<double>::distance(record.entry, entry);
+                if (neighbor.generation == generation_ && neighbor.cost <= cost) {
+                    continue;
+                }
+                neighbor = {generation_, false, current, cost, entry};
+                open_.emplace_back(-(cost + Vec2<double>::distance(entry, target)), next);
+                std::push_heap(open_.begin(), open_.end());
+            }
+        }
+        return false;
+    }
+
+    // Portals between consecutive corridor triangles as (left, right) pairs seen when walking towards the goal.
+    void collect_portals(const NavMesh<T>& mesh, const Vec2<T>& start, const Vec2<T>& goal)
+    {
+        portals_.clear();
+        portals_.emplace_back(start, start);
+        for (std::size_t i = 0; i + 1 < corridor_.size(); ++i) {
+            for (std::size_t edge = 0; edge < 3; ++edge) {
+                if (mesh.neighbor(corridor_[i], edge) == corridor_[i + 1]) {
+                    const auto& triangle = mesh.triangle(corridor_[i]);
+                    portals_.emplace_back(mesh.vertex(triangle[(edge + 1) % 3]), mesh.vertex(triangle[edge]));
+                    break;
+                }
+            }
+        }
+        portals_.emplace_back(goal, goal);
+    }
+
+    [[nodiscard]] static double cross(const Vec2<T>& a, const Vec2<T>& b, const Vec2<T>& c) noexcept
+    {
+        return (static_cast<double>(b.x()) - a.x()) * (static_cast<double>(c.y()) - a.y()) -
+               (static_cast<double>(b.y()) - a.y()) * (static_cast<double>(c.x()) - a.x());
+    }
+
+    // Simple stupid funnel algorithm (Mononen): narrows the funnel portal by portal and emits the apex whenever one
+    // side crosses over the other, restarting the scan from there.
+    void string_pull(std::vector<Vec2<T>>& path) const
+    {
+        Vec2<T> apex = portals_[0].first;
+        Vec2<T> left = portals_[0].first;
+        Vec2<T> right = portals_[0].second;
+        std::size_t apex_index = 0;
+        std::size_t left_index = 0;
+        std::size_t right_index = 0;
+        path.push_back(apex);
+
+        for (std::size_t i = 1; i < portals_.size(); ++i) {
+            const auto& [portal_left, portal_right] = portals_[i];
+
+            if (cross(apex, right, portal_right) >= 0) {
+                if (apex == right || cross(apex, left, portal_right) < 0) {
+                    right = portal_right;
+                    right_index = i;
+                } else {
+                    if (path.back() != left) {
+                        path.push_back(left);
+                    }
+                    apex = left;
+                    apex_index = left_index;
+                    left = apex;
+                    right = apex;
+                    left_index = apex_index;
+                    right_index = apex_index;
+                    i = apex_index;
+                    continue;
+                }
+            }
+
+            if (cross(apex, left, portal_left) <= 0) {
+                if (apex == left || cross(apex, right, portal_left) > 0) {
+                    left = portal_left;
+                    left_index = i;
+                } else {
+                    if (path.back() != right) {
+                        path.push_back(right);
+                    }
+                    apex = right;
+                    apex_index = right_index;
+                    left = apex;
+                    right = apex;
+                    left_index = apex_index;
+                    right_index = apex_index;
+                    i = apex_index;
+                    continue;
+                }
+            }
+        }
+        if (path.back() != portals_.back().first) {
+            path.push_back(portals_.back().first);
+        }
+    }
+};
+
+} // namespace dm
@@ -0,0 +1,858 @@
+#pragma once
+
+#include "vec2.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dm {
+
+enum class JoinType
+{
+    miter,
+    square,
+    round
+};
+
+enum class EndType
+{
+    butt,
+    square,
+    round
+};
+
+struct OffsetOptions
+{
+    JoinType join = JoinType::miter;
+    double miter_limit = 2.0;
+    double arc_tolerance = 0.25;
+};
+
+// Offsets (buffers) polygons and polylines. Each input ring is offset edge by edge with the requested joins, and the
+// resulting raw outlines are cleaned up by splitting them at every intersection and keeping the faces with positive
+// winding number, so loops produced by concave corners and overlapping outlines disappear. Intersections are found
+// through a uniform grid and orientation tests are exact for integral T, which keeps the cleanup near linear for the
+// typical case of rings with hundreds of thousands of mostly local edges.
+//
+// Polygons use the usual convention of counter-clockwise outer rings and clockwise holes; a positive delta grows the
+// filled area. Results follow the same convention. The functions return std::nullopt if rounding intersections to the
+// coordinate grid keeps creating new crossings, so that the outlines never form a planar arrangement.
+template <typename T>
+class PolygonOffsetter
+{
+  public:
+    using Ring = std::vector<Vec2<T>>;
+
+    explicit PolygonOffsetter(OffsetOptions options = {}) : options_{options} {}
+
+    [[nodiscard]] std::optional<std::vector<Ring>> offset_polygon(std::span<const Ring> rings, double delta)
+    {
+        begin(delta);
+        for (const Ring& ring : rings) {
+            add_closed(ring, delta);
+        }
+        return clean_up();
+    }
+
+    // A single ring cannot be a hole, so it is accepted in either orientation; a clockwise ring is offset as its
+    // counter-clockwise reversal.
+    [[nodiscard]] std::optional<std::vector<Ring>> offset_polygon(std::span<const Vec2<T>> ring, double delta)
+    {
+        begin(delta);
+        if (signed_area(ring) < 0) {
+            const Ring reversed(ring.rbegin(), ring.rend());
+            add_closed(reversed, delta);
+        } else {
+            add_closed(ring, delta);
+        }
+        return clean_up();
+    }
+
+    // Outline of all points within `distance` of the path.
+    [[nodiscard]] std::optional<std::vector<Ring>> offset_polyline(std::span<const Vec2<T>> path, double distance,
+                                                                   EndType end)
+    {
+        distance = std::abs(distance);
+        begin(distance);
+        add_open(path, distance, end);
+        return clean_up();
+    }
+
+  private:
+    // __extension__ keeps -Wpedantic quiet about the non-standard 128-bit integer.
+    __extension__ typedef __int128 int128;
+    using wide_type = std::conditional_t<std::is_integral_v<T>, int128, long double>;
+    using index_type = std::uint32_t;
+
+    struct Segment
+    {
+        Vec2<T> a;
+        Vec2<T> b;
+        bool fresh;
+    };
+
+    struct CellRange
+    {
+        index_type x0;
+        index_type y0;
+        index_type x1;
+        index_type y1;
+    };
+
+    struct SplitPoint
+    {
+        index_type segment;
+        long double t;
+        Vec2<T> point;
+    };
+
+    struct Edge
+    {
+        index_type from;
+        index_type to;
+        int winding;
+    };
+
+    OffsetOptions options_;
+    double steps_per_radian_ = 0;
+    double step_sin_ = 0;
+    double step_cos_ = 1;
+
+    std::vector<Vec2<double>> path_;
+    std::vector<Vec2<double>> normals_;
+    std::vector<Vec2<T>> raw_ring_;
+    std::vector<Segment> segments_;
+    std::vector<Segment> pieces_;
+    std::vector<CellRange> segment_cells_;
+    std::vector<std::pair<std::uint64_t, index_type>> cell_entries_;
+    std::vector<SplitPoint> splits_;
+    std::vector<std::pair<Vec2<T>, index_type>> endpoints_;
+    std::vector<index_type> endpoint_vertex_;
+    std::vector<Vec2<T>> vertices_;
+    std::vector<Edge> edges_;
+    std::vector<index_type> outgoing_offsets_;
+    std::vector<index_type> outgoing_;
+    std::vector<index_type> outgoing_position_;
+    std::vector<index_type> face_of_;
+    std::vector<std::int64_t> face_winding_;
+    std::vector<index_type> face_start_;
+    std::vector<wide_type> face_area_;
+    std::vector<index_type> pending_faces_;
+    std::vector<index_type> component_of_;
+    std::vector<index_type> band_offsets_;
+    std::vector<index_type> band_edges_;
+    double band_min_y_ = 0;
+    double band_scale_ = 0;
+    std::vector<bool> emitted_;
+
+    static constexpr index_type none = ~index_type{0};
+    static constexpr int max_split_passes = 8;
+    static constexpr double max_grid_cells = 1 << 30;
+    static constexpr std::size_t max_cells_per_segment = 8;
+    static constexpr std::int64_t unknown_winding = INT64_MIN;
+
+    [[nodiscard]] static T to_coordinate(double value) noexcept
+    {
+        if constexpr (std::is_integral_v<T>) {
+            return static_cast<T>(std::llround(value));
+        } else {
+            return static_cast<T>(value);
+        }
+    }
+
+    [[nodiscard]] static wide_type cross(const Vec2<T>& a, const Vec2<T>& b, const Vec2<T>& c) noexcept
+    {
+        return static_cast<wide_type>(static_cast<wide_type>(b.x()) - a.x()) * (static_cast<wide_type>(c.y()) - a.y()) -
+               static_cast<wide_type>(static_cast<wide_type>(b.y()) - a.y()) * (static_cast<wide_type>(c.x()) - a.x());
+    }
+
+    [[nodiscard]] static int orientation(const Vec2<T>& a, const Vec2<T>& b, const Vec2<T>& c) noexcept
+    {
+        const wide_type value = cross(a, b, c);
+        return (value > 0) - (value < 0);
+    }
+
+    [[nodiscard]] static double signed_area(std::span<const Vec2<T>> ring) noexcept
+    {
+        double area = 0;
+        for (std::size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++) {
+            area += static_cast<double>(ring[j].x()) * static_cast<double>(ring[i].y()) -
+                    static_cast<double>(ring[i].x()) * static_cast<double>(ring[j].y());
+        }
+        return area;
+    }
+
+    void begin(double delta)
+    {
+        segments_.clear();
+        const double radius = std::abs(delta);
+        const double tolerance = std::clamp(options_.arc_tolerance, radius * 1e-6, radius * 0.25);
+        const double steps = (radius > 0) ? std::numbers::pi / std::acos(1 - tolerance / radius) : 1;
+        steps_per_radian_ = steps / (2 * std::numbers::pi);
+        step_sin_ = std::sin(2 * std::numbers::pi / steps);
+        step_cos_ = std::cos(2 * std::numbers::pi / steps);
+    }
+
+    // Raw outline generation
+
+    void load_path(std::span<const Vec2<T>> points, bool closed)
+    {
+        path_.clear();
+        for (const Vec2<T>& point : points) {
+            const Vec2<double> value{static_cast<double>(point.x()), static_cast<double>(point.y())};
+            if (path_.empty() || value != path_.back()) {
+                path_.push_back(value);
+            }
+        }
+        if (closed && path_.size() > 1 && path_.front() == path_.back()) {
+            path_.pop_back();
+        }
+
+        normals_.clear();
+        const std::size_t edge_count = closed ? path_.size() : path_.size() - 1;
+        for (std::size_t i = 0; i < edge_count && path_.size() > 1; ++i) {
+            const Vec2<double> direction = path_[(i + 1) % path_.size()] - path_[i];
+            normals_.push_back(Vec2<double>{direction.y(), -direction.x()} / direction.magnitude());
+        }
+    }
+
+    void push(const Vec2<double>& point)
+    {
+        const Vec2<T> value{to_coordinate(point.x()), to_coordinate(point.y())};
+        if (raw_ring_.empty() || raw_ring_.back() != value) {
+            raw_ring_.push_back(value);
+        }
+    }
+
+    void push_arc(const Vec2<double>& center, Vec2<double> normal, double angle, double delta)
+    {
+        const auto steps = std::max(static_cast<int>(std::lround(steps_per_radian_ * std::abs(angle))), 1);
+        const double step_sin = (angle < 0) ? -step_sin_ : step_sin_;
+        for (int i = 0; i < steps; ++i) {
+            push(center + normal * delta);
+            normal = {normal.x() * step_cos_ - step_sin * normal.y(), normal.x() * step_sin + normal.y() * step_cos_};
+        }
+    }
+
+    // Adds the outline around `point` where the offset edge with normal `from` meets the one with normal `to`.
+    void push_join(const Vec2<double>& point, const Vec2<double>& from, const Vec2<double>& to, double delta)
+    {
+        const double sin_a = std::clamp(from.x() * to.y() - to.x() * from.y(), -1.0, 1.0);
+        const double cos_a = from.x() * to.x() + from.y() * to.y();
+        if (std::abs(sin_a * delta) < options_.arc_tolerance && cos_a > 0) {
+            push(point + from * delta);
+            return;
+        }
+        if (sin_a * delta < 0) {
+            push(point + from * delta);
+            push(point);
+            push(point + to * delta);
+            return;
+        }
+
+        switch (options_.join) {
+        case JoinType::miter:
+            if (1 + cos_a >= 2 / (options_.miter_limit * options_.miter_limit)) {
+                push(point + (from + to) * (delta / (1 + cos_a)));
+                return;
+            }
+            [[fallthrough]];
+        case JoinType::square: {
+            const double skew = std::tan(std::atan2(sin_a, cos_a) / 4);
+            push(point + Vec2<double>{from.x() - from.y() * skew, from.y() + from.x() * skew} * delta);
+            push(point + Vec2<double>{to.x() + to.y() * skew, to.y() - to.x() * skew} * delta);
+            return;
+        }
+        case JoinType::round:
+            push_arc(point, from, std::atan2(sin_a, cos_a), delta);
+            push(point + to * delta);
+            return;
+        }
+    }
+
+    void push_cap(const Vec2<double>& point, const Vec2<double>& normal, double delta, EndType end)
+    {
+        const Vec2<double> tangent{-normal.y(), normal.x()};
+        switch (end) {
+        case EndType::butt:
+            push(point + normal * delta);
+            push(point - normal * delta);
+            return;
+        case EndType::square:
+            push(point + (normal + tangent) * delta);
+            push(point + (tangent - normal) * delta);
+            return;
+        case EndType::round:
+            push_arc(point, normal, std::numbers::pi, delta);
+            push(point - normal * delta);
+            return;
+        }
+    }
+
+    void add_closed(std::span<const Vec2<T>> ring, double delta)
+    {
+        load_path(ring, true);
+        if (path_.size() < 3) {
+            return;
+        }
+        raw_ring_.clear();
+        const std::size_t n = path_.size();
+        for (std::size_t i = 0; i < n; ++i) {
+            push_join(path_[i], normals_[(i + n - 1) % n], normals_[i], delta);
+        }
+        add_raw_ring();
+    }
+
+    void add_open(std::span<const Vec2<T>> path, double delta, EndType end)
+    {
+        load_path(path, false);
+        if (path_.empty() || delta == 0) {
+            return;
+        }
+        raw_ring_.clear();
+        if (path_.size() == 1) {
+            if (end == EndType::butt) {
+                return;
+            }
+            push_cap(path_[0], {0, -1}, delta, end);
+            push_cap(path_[0], {0, 1}, delta, end);
+            add_raw_ring();
+            return;
+        }
+
+        const std::size_t n = path_.size();
+        push(path_[0] + normals_[0] * delta);
+        for (std::size_t i = 1; i + 1 < n; ++i) {
+            push_join(path_[i], normals_[i - 1], normals_[i], delta);
+        }
+        push_cap(path_[n - 1], normals_[n - 2], delta, end);
+        for (std::size_t i = n - 2; i > 0; --i) {
+            push_join(path_[i], -normals_[i], -normals_[i - 1], delta);
+        }
+        push_cap(path_[0], -normals_[0], delta, end);
+        add_raw_ring();
+    }
+
+    void add_raw_ring()
+    {
+        while (raw_ring_.size() > 1 && raw_ring_.front() == raw_ring_.back()) {
+            raw_ring_.pop_back();
+        }
+        if (raw_ring_.size() < 3) {
+            return;
+        }
+        for (std::size_t i = 0; i < raw_ring_.size(); ++i) {
+            segments_.push_back({raw_ring_[i], raw_ring_[(i + 1) % raw_ring_.size()], true});
+        }
+    }
+
+    // Intersection splitting
+
+    // Buckets segments into a sparse grid whose cells are about twice the mean segment extent, then tests the pairs
+    // sharing a cell. The cell size doubles until the buckets hold at most a few entries per segment.
+    void find_splits()
+    {
+        double min_x = static_cast<double>(segments_[0].a.x());
+        double min_y = static_cast<double>(segments_[0].a.y());
+        double max_x = min_x;
+        double max_y = min_y;
+        double mean_extent = 0;
+        for (const Segment& segment : segments_) {
+            for (const Vec2<T>& point : {segment.a, segment.b}) {
+                min_x = std::min(min_x, static_cast<double>(point.x()));
+                min_y = std::min(min_y, static_cast<double>(point.y()));
+                max_x = std::max(max_x, static_cast<double>(point.x()));
+                max_y = std::max(max_y, static_cast<double>(point.y()));
+            }
+            mean_extent += static_cast<double>(Vec2<T>::chebyshev_distance(segment.a, segment.b));
+        }
+        mean_extent /= static_cast<double>(segments_.size());
+
+        const double span = std::max({max_x - min_x, max_y - min_y, 1.0});
+        double cell_size = std::max(2 * mean_extent, span / max_grid_cells);
+        std::size_t entry_count = 0;
+        segment_cells_.resize(segments_.size());
+        do {
+            const double scale = 1 / cell_size;
+            entry_count = 0;
+            for (std::size_t i = 0; i < segments_.size(); ++i) {
+                const Segment& segment = segments_[i];
+                const auto a_x = static_cast<double>(segment.a.x()) - min_x;
+                const auto a_y = static_cast<double>(segment.a.y()) - min_y;
+                const auto b_x = static_cast<double>(segment.b.x()) - min_x;
+                const auto b_y = static_cast<double>(segment.b.y()) - min_y;
+                const CellRange range{static_cast<index_type>(std::min(a_x, b_x) * scale),
+                                      static_cast<index_type>(std::min(a_y, b_y) * scale),
+                                      static_cast<index_type>(std::max(a_x, b_x) * scale),
+                                      static_cast<index_type>(std::max(a_y, b_y) * scale)};
+                segment_cells_[i] = range;
+                entry_count += std::size_t{range.x1 - range.x0 + 1} * (range.y1 - range.y0 + 1);
+            }
+            cell_size *= 2;
+        } while (entry_count > max_cells_per_segment * segments_.size());
+
+        cell_entries_.clear();
+        cell_entries_.reserve(entry_count);
+        for (index_type i = 0; i < segments_.size(); ++i) {
+            const CellRange& range = segment_cells_[i];
+            for (index_type y = range.y0; y <= range.y1; ++y) {
+                for (index_type x = range.x0; x <= range.x1; ++x) {
+                    cell_entries_.emplace_back((std::uint64_t{y} << 32) | x, i);
+                }
+            }
+        }
+        std::sort(cell_entries_.begin(), cell_entries_.end());
+
+        splits_.clear();
+        for (std::size_t begin = 0, end = 0; begin < cell_entries_.size(); begin = end) {
+            const std::uint64_t key = cell_entries_[begin].first;
+            for (end = begin + 1; end < cell_entries_.size() && cell_entries_[end].first == key; ++end) {}
+            const auto x = static_cast<index_type>(key);
+            const auto y = static_cast<index_type>(key >> 32);
+            for (std::size_t i = begin; i < end; ++i) {
+                for (std::size_t j = i + 1; j < end; ++j) {
+                    const index_type first = cell_entries_[i].second;
+                    const index_type second = cell_entries_[j].second;
+                    if (!segments_[first].fresh && !segments_[second].fresh) {
+                        continue;
+                    }
+                    const CellRange& lhs = segment_cells_[first];
+                    const CellRange& rhs = segment_cells_[second];
+                    // Each pair is tested only in the first cell their ranges share.
+                    if (std::max(lhs.x0, rhs.x0) == x && std::max(lhs.y0, rhs.y0) == y) {
+                        intersect(first, second);
+                    }
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] static bool within_box(const Vec2<T>& point, const Segment& segment) noexcept
+    {
+        return point.x() >= std::min(segment.a.x(), segment.b.x()) &&
+               point.x() <= std::max(segment.a.x(), segment.b.x()) &&
+               point.y() >= std::min(segment.a.y(), segment.b.y()) &&
+               point.y() <= std::max(segment.a.y(), segment.b.y());
+    }
+
+    void add_split(index_type segment, const Vec2<T>& point)
+    {
+        const Segment& s = segments_[segment];
+        if (point == s.a || point == s.b) {
+            return;
+        }
+        const long double dx = static_cast<long double>(s.b.x()) - s.a.x();
+        const long double dy = static_cast<long double>(s.b.y()) - s.a.y();
+        const long double t = ((static_cast<long double>(point.x()) - s.a.x()) * dx +
+                               (static_cast<long double>(point.y()) - s.a.y()) * dy) /
+                              (dx * dx + dy * dy);
+        splits_.push_back({segment, t, point});
+    }
+
+    void intersect(index_type first, index_type second)
+    {
+        const Segment& s = segments_[first];
+        const Segment& r = segments_[second];
+        if (std::max(s.a.x(), s.b.x()) < std::min(r.a.x(), r.b.x()) ||
+            std::max(r.a.x(), r.b.x()) < std::min(s.a.x(), s.b.x()) ||
+            std::max(s.a.y(), s.b.y()) < std::min(r.a.y(), r.b.y()) ||
+            std::max(r.a.y(), r.b.y()) < std::min(s.a.y(), s.b.y())) {
+            return;
+        }
+        const int o1 = orientation(s.a, s.b, r.a);
+        const int o2 = orientation(s.a, s.b, r.b);
+        const int o3 = orientation(r.a, r.b, s.a);
+        const int o4 = orientation(r.a, r.b, s.b);
+
+        if (o1 * o2 < 0 && o3 * o4 < 0) {
+            const long double denominator = static_cast<long double>(cross(Vec2<T>{}, s.b - s.a, r.b - r.a));
+            const long double t = static_cast<long double>(cross(Vec2<T>{}, r.a - s.a, r.b - r.a)) / denominator;
+            const long double x = s.a.x() + t * (static_cast<long double>(s.b.x()) - s.a.x());
+            const long double y = s.a.y() + t * (static_cast<long double>(s.b.y()) - s.a.y());
+            const Vec2<T> point{to_coordinate(static_cast<double>(x)), to_coordinate(static_cast<double>(y))};
+            add_split(first, point);
+            add_split(second, point);
+            return;
+        }
+        if (o1 == 0 && within_box(r.a, s)) {
+            add_split(first, r.a);
+        }
+        if (o2 == 0 && within_box(r.b, s)) {
+            add_split(first, r.b);
+        }
+        if (o3 == 0 && within_box(s.a, r)) {
+            add_split(second, s.a);
+        }
+        if (o4 == 0 && within_box(s.b, r)) {
+            add_split(second, s.b);
+        }
+    }
+
+    // Replaces every segment by its pieces between split points. Only new pieces can take part in intersections
+    // found by the next pass.
+    void split_segments()
+    {
+        std::sort(splits_.begin(), splits_.end(), [](const SplitPoint& lhs, const SplitPoint& rhs) {
+            return (lhs.segment != rhs.segment) ? lhs.segment < rhs.segment : lhs.t < rhs.t;
+        });
+
+        pieces_.clear();
+        auto add_piece = [this](const Vec2<T>& from, const Vec2<T>& to, bool fresh) {
+            if (from != to) {
+                pieces_.push_back({from, to, fresh});
+            }
+        };
+        std::size_t next_split = 0;
+        for (index_type i = 0; i < segments_.size(); ++i) {
+            Vec2<T> from = segments_[i].a;
+            const bool split = next_split < splits_.size() && splits_[next_split].segment == i;
+            for (; next_split < splits_.size() && splits_[next_split].segment == i; ++next_split) {
+                add_piece(from, splits_[next_split].point, true);
+                from = splits_[next_split].point;
+            }
+            add_piece(from, segments_[i].b, split);
+        }
+        segments_.swap(pieces_);
+    }
+
+    // Merges coincident segments into edges between shared vertices, summing their winding contributions.
+    void build_edges()
+    {
+        endpoints_.clear();
+        for (index_type i = 0; i < segments_.size(); ++i) {
+            endpoints_.emplace_back(segments_[i].a, 2 * i);
+            endpoints_.emplace_back(segments_[i].b, 2 * i + 1);
+        }
+        std::sort(endpoints_.begin(), endpoints_.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first < rhs.first;
+        });
+
+        vertices_.clear();
+        endpoint_vertex_.resize(endpoints_.size());
+        for (const auto& [point, endpoint] : endpoints_) {
+            if (vertices_.empty() || vertices_.back() != point) {
+                vertices_.push_back(point);
+            }
+            endpoint_vertex_[endpoint] = static_cast<index_type>(vertices_.size() - 1);
+        }
+
+        edges_.clear();
+        for (index_type i = 0; i < segments_.size(); ++i) {
+            const index_type a = endpoint_vertex_[2 * i];
+            const index_type b = endpoint_vertex_[2 * i + 1];
+            edges_.push_back((a < b) ? Edge{a, b, 1} : Edge{b, a, -1});
+        }
+
+        std::sort(edges_.begin(), edges_.end(), [](const Edge& lhs, const Edge& rhs) {
+            return (lhs.from != rhs.from) ? lhs.from < rhs.from : lhs.to < rhs.to;
+        });
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < edges_.size();) {
+            Edge merged = edges_[i];
+            for (++i; i < edges_.size() && edges_[i].from == merged.from && edges_[i].to == merged.to; ++i) {
+                merged.winding += edges_[i].winding;
+            }
+            if (merged.winding != 0) {
+                edges_[kept++] = merged;
+            }
+        }
+        edges_.resize(kept);
+    }
+
+    // Planar arrangement. Half-edge 2e runs along edge e, 2e + 1 against it.
+
+    [[nodiscard]] index_type origin(index_type half_edge) const noexcept
+    {
+        const Edge& edge = edges_[half_edge / 2];
+        return (half_edge % 2 == 0) ? edge.from : edge.to;
+    }
+
+    [[nodiscard]] index_type destination(index_type half_edge) const noexcept
+    {
+        return origin(half_edge ^ 1);
+    }
+
+    [[nodiscard]] Vec2<T> direction(index_type half_edge) const noexcept
+    {
+        return vertices_[destination(half_edge)] - vertices_[origin(half_edge)];
+    }
+
+    [[nodiscard]] static bool angle_less(const Vec2<T>& lhs, const Vec2<T>& rhs) noexcept
+    {
+        auto half = [](const Vec2<T>& value) { return value.y() < 0 || (value.y() == 0 && value.x() < 0); };
+        if (half(lhs) != half(rhs)) {
+            return !half(lhs);
+        }
+        return cross(Vec2<T>{}, lhs, rhs) > 0;
+    }
+
+    void build_arrangement()
+    {
+        const std::size_t vertex_count = vertices_.size();
+        const auto half_edge_count = static_cast<index_type>(edges_.size() * 2);
+        outgoing_offsets_.assign(vertex_count + 1, 0);
+        for (index_type h = 0; h < half_edge_count; ++h) {
+            ++outgoing_offsets_[origin(h) + 1];
+        }
+        std::partial_sum(outgoing_offsets_.begin(), outgoing_offsets_.end(), outgoing_offsets_.begin());
+        outgoing_.resize(half_edge_count);
+        outgoing_position_.assign(outgoing_offsets_.begin(), outgoing_offsets_.end() - 1);
+        for (index_type h = 0; h < half_edge_count; ++h) {
+            outgoing_[outgoing_position_[origin(h)]++] = h;
+        }
+        for (std::size_t v = 0; v < vertex_count; ++v) {
+            std::sort(outgoing_.begin() + outgoing_offsets_[v], outgoing_.begin() + outgoing_offsets_[v + 1],
+                      [this](index_type lhs, index_type rhs) { return angle_less(direction(lhs), direction(rhs)); });
+        }
+        outgoing_position_.resize(half_edge_count);
+        for (index_type slot = 0; slot < half_edge_count; ++slot) {
+            outgoing_position_[outgoing_[slot]] = slot;
+        }
+    }
+
+    // Next half-edge around the face to the left of `half_edge`: the first one clockwise from its twin.
+    [[nodiscard]] index_type next(index_type half_edge) const noexcept
+    {
+        const index_type vertex = destination(half_edge);
+        const index_type slot = outgoing_position_[half_edge ^ 1];
+        return outgoing_[(slot == outgoing_offsets_[vertex]) ? outgoing_offsets_[vertex + 1] - 1 : slot - 1];
+    }
+
+    [[nodiscard]] index_type find_component(index_type vertex) noexcept
+    {
+        while (component_of_[vertex] != vertex) {
+            component_of_[vertex] = component_of_[component_of_[vertex]];
+            vertex = component_of_[vertex];
+        }
+        return vertex;
+    }
+
+    [[nodiscard]] index_type band(double y) const noexcept
+    {
+        return static_cast<index_type>((y - band_min_y_) * band_scale_);
+    }
+
+    // Buckets the non-horizontal edges into horizontal bands by their y ranges, so that a ray cast along a row meets
+    // only the edges of one band. Band heights double, as grid cells do in find_splits, until edges spanning several
+    // bands add up to a few entries each.
+    void build_bands()
+    {
+        double min_y = static_cast<double>(vertices_.front().y());
+        double max_y = min_y;
+        double mean_height = 0;
+        for (const Edge& edge : edges_) {
+            const auto from = static_cast<double>(vertices_[edge.from].y());
+            const auto to = static_cast<double>(vertices_[edge.to].y());
+            min_y = std::min({min_y, from, to});
+            max_y = std::max({max_y, from, to});
+            mean_height += std::abs(to - from);
+        }
+        mean_height /= static_cast<double>(edges_.size());
+
+        band_min_y_ = min_y;
+        // At most one band per edge, so that the band table stays linear in the edges however far apart they lie.
+        double band_height =
+            std::max(2 * mean_height, std::max(max_y - min_y, 1.0) / static_cast<double>(edges_.size()));
+        std::size_t entry_count = 0;
+        do {
+            band_scale_ = 1 / band_height;
+            entry_count = 0;
+            for (const Edge& edge : edges_) {
+                const auto [low, high] = std::minmax(vertices_[edge.from].y(), vertices_[edge.to].y());
+                if (low != high) {
+                    entry_count += band(static_cast<double>(high)) - band(static_cast<double>(low)) + 1;
+                }
+            }
+            band_height *= 2;
+        } while (entry_count > max_cells_per_segment * edges_.size());
+
+        band_offsets_.assign(band(max_y) + 2, 0);
+        const auto for_each_entry = [this](auto&& add) {
+            for (index_type e = 0; e < edges_.size(); ++e) {
+                const auto [low, high] = std::minmax(vertices_[edges_[e].from].y(), vertices_[edges_[e].to].y());
+                if (low != high) {
+                    for (index_type b = band(static_cast<double>(low)); b <= band(static_cast<double>(high)); ++b) {
+                        add(b, e);
+                    }
+                }
+            }
+        };
+        for_each_entry([this](index_type b, index_type) { ++band_offsets_[b + 1]; });
+        std::partial_sum(band_offsets_.begin(), band_offsets_.end(), band_offsets_.begin());
+        band_edges_.resize(band_offsets_.back());
+        std::vector<index_type> cursor(band_offsets_.begin(), band_offsets_.end() - 1);
+        for_each_entry([&](index_type b, index_type e) { band_edges_[cursor[b]++] = e; });
+    }
+
+    // Winding number of `point` with respect to the edges outside `excluded_component`, by casting a ray towards +x.
+    [[nodiscard]] std::int64_t winding_number(const Vec2<T>& point, index_type excluded_component) noexcept
+    {
+        std::int64_t winding = 0;
+        const index_type row = band(static_cast<double>(point.y()));
+        for (index_type i = band_offsets_[row]; i < band_offsets_[row + 1]; ++i) {
+            const Edge& edge = edges_[band_edges_[i]];
+            if (find_component(edge.from) == excluded_component) {
+                continue;
+            }
+            const Vec2<T>& a = vertices_[edge.from];
+            const Vec2<T>& b = vertices_[edge.to];
+            if (a.y() <= point.y()) {
+                if (b.y() > point.y() && orientation(a, b, point) > 0) {
+                    winding += edge.winding;
+                }
+            } else if (b.y() <= point.y() && orientation(a, b, point) < 0) {
+                winding -= edge.winding;
+            }
+        }
+        return winding;
+    }
+
+    // Traces the faces of the arrangement and assigns each its winding number: the unbounded side of every connected
+    // component is found by ray casting against the other components through the bands, and windings propagate
+    // inward across edges.
+    void wind_faces()
+    {
+        const auto half_edge_count = static_cast<index_type>(edges_.size() * 2);
+        face_of_.assign(half_edge_count, none);
+        face_winding_.clear();
+        face_start_.clear();
+        face_area_.clear();
+        for (index_type h = 0; h < half_edge_count; ++h) {
+            if (face_of_[h] != none) {
+                continue;
+            }
+            const auto face = static_cast<index_type>(face_start_.size());
+            wide_type area = 0;
+            index_type current = h;
+            do {
+                face_of_[current] = face;
+                area += cross(Vec2<T>{}, vertices_[origin(current)], vertices_[destination(current)]);
+                current = next(current);
+            } while (current != h && face_of_[current] == none);
+            face_start_.push_back(h);
+            face_area_.push_back(area);
+        }
+        face_winding_.assign(face_start_.size(), unknown_winding);
+
+        component_of_.resize(vertices_.size());
+        std::iota(component_of_.begin(), component_of_.end(), index_type{0});
+        for (const Edge& edge : edges_) {
+            component_of_[find_component(edge.from)] = find_component(edge.to);
+        }
+        if (!edges_.empty()) {
+            build_bands();
+        }
+
+        for (index_type face = 0; face < face_start_.size(); ++face) {
+            if (face_area_[face] >= 0 || face_winding_[face] != unknown_winding) {
+                continue;
+            }
+            const index_type component = find_component(origin(face_start_[face]));
+            face_winding_[face] = winding_number(vertices_[component], component);
+            pending_faces_.assign(1, face);
+            while (!pending_faces_.empty()) {
+                const index_type current_face = pending_faces_.back();
+                pending_faces_.pop_back();
+                const index_type start = face_start_[current_face];
+                index_type current = start;
+                do {
+                    const index_type neighbour = face_of_[current ^ 1];
+                    if (face_winding_[neighbour] == unknown_winding) {
+                        const int winding = edges_[current / 2].winding;
+                        face_winding_[neighbour] =
+                            face_winding_[current_face] + ((current % 2 == 0) ? -winding : winding);
+                        pending_faces_.push_back(neighbour);
+                    }
+                    current = next(current);
+                } while (current != start);
+            }
+        }
+    }
+
+    [[nodiscard]] bool is_boundary(index_type half_edge) const noexcept
+    {
+        return face_winding_[face_of_[half_edge]] > 0 && face_winding_[face_of_[half_edge ^ 1]] <= 0;
+    }
+
+    [[nodiscard]] index_type next_boundary(index_type half_edge) const noexcept
+    {
+        const index_type vertex = destination(half_edge);
+        const index_type first = outgoing_offsets_[vertex];
+        const index_type degree = outgoing_offsets_[vertex + 1] - first;
+        index_type slot = outgoing_position_[half_edge ^ 1] - first;
+        for (index_type step = 0; step < degree; ++step) {
+            slot = (slot == 0) ? degree - 1 : slot - 1;
+            if (is_boundary(outgoing_[first + slot])) {
+                return outgoing_[first + slot];
+            }
+        }
+        return none;
+    }
+
+    [[nodiscard]] std::vector<Ring> trace_result()
+    {
+        std::vector<Ring> result;
+        const auto half_edge_count = static_cast<index_type>(edges_.size() * 2);
+        emitted_.assign(half_edge_count, false);
+        for (index_type h = 0; h < half_edge_count; ++h) {
+            if (emitted_[h] || !is_boundary(h)) {
+                continue;
+            }
+            Ring ring;
+            for (index_type current = h; current != none && !emitted_[current]; current = next_boundary(current)) {
+                emitted_[current] = true;
+                const Vec2<T>& point = vertices_[origin(current)];
+                while (ring.size() >= 2 && orientation(ring[ring.size() - 2], ring.back(), point) == 0) {
+                    ring.pop_back();
+                }
+                ring.push_back(point);
+            }
+            while (ring.size() >= 3 && orientation(ring[ring.size() - 2], ring.back(), ring.front()) == 0) {
+                ring.pop_back();
+            }
+            while (ring.size() >= 3 && orientation(ring.back(), ring[0], ring[1]) == 0) {
+                ring.erase(ring.begin());
+            }
+            if (ring.size() >= 3) {
+                result.push_back(std::move(ring));
+            }
+        }
+        return result;
+    }
+
+    [[nodiscard]] std::optional<std::vector<Ring>> clean_up()
+    {
+        if (segments_.empty()) {
+            return std::vector<Ring>{};
+        }
+        // Rounding split points to the coordinate grid can introduce new crossings, so splitting repeats until the
+        // segments form a planar arrangement; this almost always takes two passes. Tracing faces of an arrangement
+        // that still crosses itself would produce garbage, so giving up is the only safe answer.
+        for (int pass = 0;; ++pass) {
+            find_splits();
+            if (splits_.empty()) {
+                break;
+            }
+            if (pass == max_split_passes) {
+                return std::nullopt;
+            }
+            split_segments();
+        }
+        build_edges();
+        build_arrangement();
+        wind_faces();
+        return trace_result();
+    }
+};
+
+} // namespace dm
@@ -0,0 +1,277 @@
+#pragma once
+
+#include "parallel.h"
+#include "point_grid.h"
+#include "vec2.h"
+
+#include <cmath>
+#include <cstddef>
+
+#include <algorithm>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace dm {
+
+template <typename T>
+struct CrowdAgent
+{
+    Vec2<T> position;
+    Vec2<T> velocity;
+    Vec2<T> preferred_velocity;
+    T radius;
+    T max_speed;
+};
+
+struct OrcaOptions
+{
+    // How far ahead, in time, collisions with other agents are avoided.
+    double time_horizon = 2.0;
+    double neighbor_distance = 10.0;
+    std::size_t max_neighbors = 10;
+};
+
+namespace detail {
+
+// Half-plane of permitted velocities: everything to the left of `direction` through `point`.
+template <typename T>
+struct OrcaLine
+{
+    Vec2<T> point;
+    Vec2<T> direction;
+};
+
+template <typename T>
+[[nodiscard]] constexpr T determinant(const Vec2<T>& lhs, const Vec2<T>& rhs) noexcept
+{
+    return lhs.x() * rhs.y() - lhs.y() * rhs.x();
+}
+
+template <typename T>
+[[nodiscard]] constexpr T dot_product(const Vec2<T>& lhs, const Vec2<T>& rhs) noexcept
+{
+    return lhs.x() * rhs.x() + lhs.y() * rhs.y();
+}
+
+inline constexpr double orca_epsilon = 1e-5;
+
+// Optimum on line `index` subject to lines [0, index) and the speed circle.
+template <typename T>
+bool linear_program_1(std::span<const OrcaLine<T>> lines, std::size_t index, T radius, const Vec2<T>& optimum,
+                      bool optimize_direction, Vec2<T>& result) noexcept
+{
+    const OrcaLine<T>& line = lines[index];
+    const T along = dot_product(line.point, line.direction);
+    const T discriminant = along * along + radius * radius - line.point.magnitude_squared();
+    if (discriminant < 0) {
+        return false;
+    }
+    const T root = std::sqrt(discriminant);
+    T left = -along - root;
+    T right = -along + root;
+    for (std::size_t i = 0; i < index; ++i) {
+        const T denominator = determinant(line.direction, lines[i].direction);
+        const T numerator = determinant(lines[i].direction, line.point - lines[i].point);
+        if (std::abs(denominator) <= orca_epsilon) {
+            if (numerator < 0) {
+                return false;
+            }
+            continue;
+        }
+        const T t = numerator / denominator;
+        if (denominator >= 0) {
+            right = std::min(right, t);
+        } else {
+            left = std::max(left, t);
+        }
+        if (left > right) {
+            return false;
+        }
+    }
+
+    if (optimize_direction) {
+        result = line.point + ((dot_product(optimum, line.direction) > 0) ? right : left) * line.direction;
+    } else {
+        const T t = std::clamp(dot_product(line.direction, optimum - line.point), left, right);
+        result = line.point + t * line.direction;
+    }
+    return true;
+}
+
+// Incremental 2D linear program (Seidel-style) over the half-planes inside the speed circle. Returns the index of the
+// first line that made the program infeasible, or lines.size() on success.
+template <typename T>
+std::size_t linear_program_2(std::span<const OrcaLine<T>> lines, T radius, const Vec2<T>& optimum,
+                             bool optimize_direction, Vec2<T>& result) noexcept
+{
+    if (optimize_direction) {
+        result = optimum * radius;
+    } else if (optimum.magnitude_squared() > radius * radius) {
+        result = optimum * static_cast<T>(radius / optimum.magnitude());
+    } else {
+        result = optimum;
+    }
+    for (std::size_t i = 0; i < lines.size(); ++i) {
+        if (determinant(lines[i].direction, lines[i].point - result) > 0) {
+            const Vec2<T> previous = result;
+            if (!linear_program_1(lines, i, radius, optimum, optimize_direction, result)) {
+                result = previous;
+                return i;
+            }
+        }
+    }
+    return lines.size();
+}
+
+// Infeasible program: minimises the largest violation over the remaining lines instead, one dimension higher.
+template <typename T>
+void linear_program_3(std::span<const OrcaLine<T>> lines, std::size_t first_failure, T radius, Vec2<T>& result,
+                      std::vector<OrcaLine<T>>& projected)
+{
+    T distance = 0;
+    for (std::size_t i = first_failure; i < lines.size(); ++i) {
+        if (determinant(lines[i].direction, lines[i].point - result) <= distance) {
+            continue;
+        }
+        projected.clear();
+        for (std::size_t j = 0; j < i; ++j) {
+            OrcaLine<T> line;
+            const T denominator = determinant(lines[i].direction, lines[j].direction);
+            if (std::abs(denominator) <= orca_epsilon) {
+                if (dot_product(lines[i].direction, lines[j].direction) > 0) {
+                    continue;
+                }
+                line.point = (lines[i].point + lines[j].point) * T{0.5};
+            } else {
+                line.point = lines[i].point +
+                             (determinant(lines[j].direction, lines[i].point - lines[j].point) / denominator) *
+                                 lines[i].direction;
+            }
+            line.direction = lines[j].direction - lines[i].direction;
+            line.direction /= static_cast<T>(line.direction.magnitude());
+            projected.push_back(line);
+        }
+        const Vec2<T> previous = result;
+        const Vec2<T> inward{-lines[i].direction.y(), lines[i].direction.x()};
+        if (linear_program_2(std::span<const OrcaLine<T>>{projected}, radius, inward, true, result) <
+            projected.size()) {
+            result = previous;
+        }
+        distance = determinant(lines[i].direction, lines[i].point - result);
+    }
+}
+
+// Velocity obstacle of `other` as seen by `agent`, truncated at the time horizon, as an ORCA half-plane that takes
+// half of the avoidance responsibility.
+template <typename T>
+[[nodiscard]] OrcaLine<T> orca_line(const CrowdAgent<T>& agent, const CrowdAgent<T>& other, T inverse_horizon,
+                                    T inverse_dt) noexcept
+{
+    const Vec2<T> relative_position = other.position - agent.position;
+    const Vec2<T> relative_velocity = agent.velocity - other.velocity;
+    const T distance_squared = relative_position.magnitude_squared();
+    const T combined_radius = agent.radius + other.radius;
+    const T combined_radius_squared = combined_radius * combined_radius;
+
+    OrcaLine<T> line;
+    Vec2<T> u;
+    if (distance_squared > combined_radius_squared) {
+        const Vec2<T> w = relative_velocity - inverse_horizon * relative_position;
+        const T w_length_squared = w.magnitude_squared();
+        const T w_dot_position = dot_product(w, relative_position);
+        if (w_dot_position < 0 && w_dot_position * w_dot_position > combined_radius_squared * w_length_squared) {
+            // Closest to the cut-off circle.
+            const auto w_length = static_cast<T>(std::sqrt(w_length_squared));
+            const Vec2<T> unit_w = w / w_length;
+            line.direction = {unit_w.y(), -unit_w.x()};
+            u = (combined_radius * inverse_horizon - w_length) * unit_w;
+        } else {
+            // Closest to one of the legs of the cone.
+            const auto leg = static_cast<T>(std::sqrt(distance_squared - combined_radius_squared));
+            const T x = relative_position.x();
+            const T y = relative_position.y();
+            if (determinant(relative_position, w) > 0) {
+                line.direction = Vec2<T>{x * leg - y * combined_radius, x * combined_radius + y * leg} /
+                                 distance_squared;
+            } else {
+                line.direction = -Vec2<T>{x * leg + y * combined_radius, -x * combined_radius + y * leg} /
+                                 distance_squared;
+            }
+            u = dot_product(relative_velocity, line.direction) * line.direction - relative_velocity;
+        }
+    } else {
+        // Already overlapping: resolve within one time step.
+        const Vec2<T> w = relative_velocity - inverse_dt * relative_position;
+        const auto w_length = static_cast<T>(w.magnitude());
+        const Vec2<T> unit_w = (w_length > 0) ? w / w_length : Vec2<T>::unit_x();
+        line.direction = {unit_w.y(), -unit_w.x()};
+        u = (combined_radius * inverse_dt - w_length) * unit_w;
+    }
+    line.point = agent.velocity + T{0.5} * u;
+    return line;
+}
+
+} // namespace detail
+
+// Optimal reciprocal collision avoidance (van den Berg et al.) for agents without static obstacles. Every agent
+// solves its own small linear program against its nearest neighbours, reading the shared agent array and writing
+// only its own output velocity, so agents are processed in parallel without synchronisation.
+template <typename T>
+class OrcaSolver
+{
+  public:
+    explicit OrcaSolver(OrcaOptions options = {}) noexcept : options_{options} {}
+
+    void compute(std::span<const CrowdAgent<T>> agents, T dt, std::span<Vec2<T>> velocities)
+    {
+        positions_.resize(agents.size());
+        std::transform(agents.begin(), agents.end(), positions_.begin(),
+                       [](const CrowdAgent<T>& agent) { return agent.position; });
+        grid_.build(positions_, options_.neighbor_distance);
+
+        const auto inverse_horizon = static_cast<T>(1 / options_.time_horizon);
+        const T inverse_dt = T{1} / dt;
+        const std::size_t count = std::min(agents.size(), velocities.size());
+        parallel_for(count, 256, [&](std::size_t begin, std::size_t end) {
+            std::vector<std::pair<T, std::size_t>> neighbors;
+            std::vector<detail::OrcaLine<T>> lines;
+            std::vector<detail::OrcaLine<T>> projected;
+            for (std::size_t i = begin; i < end; ++i) {
+                const CrowdAgent<T>& agent = agents[i];
+                neighbors.clear();
+                grid_.for_each_within(agent.position, options_.neighbor_distance,
+                                      [&](std::size_t index, const Vec2<T>& position) {
+                                          if (index != i) {
+                                              neighbors.emplace_back(
+                                                  Vec2<T>::distance_squared(agent.position, position), index);
+                                          }
+                                      });
+                if (neighbors.size() > options_.max_neighbors) {
+                    std::nth_element(neighbors.begin(), neighbors.begin() + options_.max_neighbors, neighbors.end());
+                    neighbors.resize(options_.max_neighbors);
+                }
+
+                lines.clear();
+                for (const auto& neighbor : neighbors) {
+                    lines.push_back(detail::orca_line(agent, agents[neighbor.second], inverse_horizon, inverse_dt));
+                }
+                const std::span<const detail::OrcaLine<T>> constraints{lines};
+                Vec2<T> velocity;
+                const std::size_t failure =
+                    detail::linear_program_2(constraints, agent.max_speed, agent.preferred_velocity, false, velocity);
+                if (failure < lines.size()) {
+                    detail::linear_program_3(constraints, failure, agent.max_speed, velocity, projected);
+                }
+                velocities[i] = velocity;
+            }
+        });
+    }
+
+  private:
+    OrcaOptions options_;
+    std::vector<Vec2<T>> positions_;
+    PointGrid<T> grid_;
+};
+
+} // namespace dm
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "morton.h"
+#include "vec2.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace dm {
+
+// Static R-tree packed bottom-up from boxes sorted by the Morton code of their centres. Every level is a contiguous
+// run of entries in one array, each node owning `node_size` consecutive entries of the level below, so the tree has no
+// pointers and building it is a sort plus one linear pass per level. Boxes are (min corner, max corner) pairs, as
+// returned by extents().
+template <typename T>
+class PackedRTree
+{
+  public:
+    using Box = std::pair<Vec2<T>, Vec2<T>>;
+    static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+    PackedRTree() = default;
+
+    explicit PackedRTree(std::span<const Box> boxes, std::size_t node_size = 16)
+    {
+        build(boxes, node_size);
+    }
+
+    void build(std::span<const Box> boxes, std::size_t node_size = 16)
+    {
+        node_size_ = std::max<std::size_t>(node_size, 2);
+        boxes_.clear();
+        links_.clear();
+        level_ends_.clear();
+        if (boxes.empty()) {
+            return;
+        }
+
+        std::vector<Vec2<T>> centers(boxes.size());
+        std::transform(boxes.begin(), boxes.end(), centers.begin(), [](const Box& box) {
+            return Vec2<T>{box.first.x() + (box.second.x() - box.first.x()) / 2,
+                           box.first.y() + (box.second.y() - box.first.y()) / 2};
+        });
+        for (const std::uint32_t index : morton_order(std::span<const Vec2<T>>{centers})) {
+            boxes_.push_back(boxes[index]);
+            links_.push_back(index);
+        }
+        level_ends_.push_back(boxes_.size());
+
+        // A single box still gets a root node above it, so queries always start from an inner node.
+        std::size_t begin = 0;
+        while (level_ends_.size() == 1 || level_ends_.back() - begin > 1) {
+            const std::size_t end = level_ends_.back();
+            for (std::size_t first = begin; first < end; first += node_size_) {
+                Box box = boxes_[first];
+                for (std::size_t i = first + 1; i < std::min(end, first + node_size_); ++i) {
+                    box.first = {std::min(box.first.x(), boxes_[i].first.x()),
+                                 std::min(box.first.y(), boxes_[i].first.y())};
+                    box.second = {std::max(box.second.x(), boxes_[i].second.x()),
+                                  std::max(box.second.y(), boxes_[i].second.y())};
+                }
+                boxes_.push_back(box);
+                links_.push_back(static_cast<std::uint32_t>(first));
+            }
+            begin = end;
+            level_ends_.push_back(boxes_.size());
+        }
+    }
+
+    // Number of indexed boxes.
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return level_ends_.empty() ? 0 : level_ends_.front();
+    }
+
+    // Calls function(index) for every box that overlaps `box`, edges included.
+    template <typename Function>
+    void for_each_overlapping(const Box& box, Function&& function) const
+    {
+        if (!boxes_.empty()) {
+            visit(boxes_.size() - 1, level_ends_.size() - 1, box, function);
+        }
+    }
+
+    // Calls function(index) for every box that contains `point`, edges included.
+    template <typename Function>
+    void for_each_containing(const Vec2<T>& point, Function&& function) const
+    {
+        for_each_overlapping(Box{point, point}, function);
+    }
+
+    // Squared distance from `point` to `box`, zero inside it.
+    [[nodiscard]] static double distance_squared(const Box& box, const Vec2<T>& point) noexcept
+    {
+        const double dx = std::max({static_cast<double>(box.first.x()) - static_cast<double>(point.x()),
+                                    static_cast<double>(point.x()) - static_cast<double>(box.second.x()), 0.0});
+        const double dy = std::max({static_cast<double>(box.first.y()) - static_cast<double>(point.y()),
+                                    static_cast<double>(point.y()) - static_cast<double>(box.second.y()), 0.0});
+        return dx * dx + dy * dy;
+    }
+
+    // Best-first search for the item nearest to `point`. `item_distance(index)` gives the exact squared distance to an
+    // item, which must be at least the squared distance to its box. Only items closer than `best_distance` are
+    // considered; `best_index` is returned with it if there is none. `queue` is scratch storage.
+    template <typename Function>
+    [[nodiscard]] std::pair<std::uint32_t, double>
+    nearest(const Vec2<T>& point, Function&& item_distance, std::vector<std::pair<double, std::uint32_t>>& queue,
+            std::uint32_t best_index = none, double best_distance = std::numeric_limits<double>::infinity()) const
+    {
+        queue.clear();
+        if (boxes_.empty()) {
+            return {best_index, best_distance};
+        }
+        const auto root = static_cast<std::uint32_t>(boxes_.size() - 1);
+        queue.emplace_back(distance_squared(boxes_[root], point), root);
+        while (!queue.empty()) {
+            std::pop_heap(queue.begin(), queue.end(), std::greater<>{});
+            const auto [distance, position] = queue.back();
+            queue.pop_back();
+            if (distance >= best_distance) {
+                break;
+            }
+            if (position < size()) {
+                return {links_[position], distance};
+            }
+            const std::size_t first = links_[position];
+            const std::size_t end = std::min<std::size_t>(first + node_size_, level_end_of(first));
+            for (std::size_t child = first; child < end; ++child) {
+                double child_distance = distance_squared(boxes_[child], point);
+                if (child_distance < best_distance && child < size()) {
+                    child_distance = item_distance(links_[child]);
+                }
+                if (child_distance < best_distance) {
+                    queue.emplace_back(child_distance, static_cast<std::uint32_t>(child));
+                    std::push_heap(queue.begin(), queue.end(), std::greater<>{});
+                }
+            }
+        }
+        return {best_index, best_distance};
+    }
+
+  private:
+    std::size_t node_size_ = 16;
+    std::vector<Box> boxes_;
+    // Original box index for the leaf level, position of the first child for the levels above.
+    std::vector<std::uint32_t> links_;
+    std::vector<std::size_t> level_ends_;
+
+    [[nodiscard]] static bool overlaps(const Box& lhs, const Box& rhs) noexcept
+    {
+        return lhs.first.x() <= rhs.second.x() && rhs.first.x() <= lhs.second.x() && lhs.first.y() <= rhs.second.y() &&
+               rhs.first.y() <= lhs.second.y();
+    }
+
+    [[nodiscard]] std::size_t level_end_of(std::size_t position) const noexcept
+    {
+        return *std::upper_bound(level_ends_.begin(), level_ends_.end(), position);
+    }
+
+    template <typename Function>
+    void visit(std::size_t position, std::size_t level, const Box& box, Function& function) const
+    {
+        const std::size_t first = links_[position];
+        const std::size_t end = std::min(first + node_size_, level_ends_[level - 1]);
+        for (std::size_t child = first; child < end; ++child) {
+            if (!overlaps(boxes_[child], box)) {
+                continue;
+            }
+            if (level == 1) {
+                function(static_cast<std::size_t>(links_[child]));
+            } else {
+                visit(child, level - 1, box, function);
+            }
+        }
+    }
+};
+
+} // namespace dm
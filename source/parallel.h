@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace dm {
+
+[[nodiscard]] inline std::size_t hardware_threads() noexcept
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs body(begin, end) over [0, count) in chunks of `grain` items. Idle threads take the next chunk, so uneven work
+// per chunk still balances. The calling thread takes part and the call returns when every chunk is done.
+template <typename Function>
+void parallel_for(std::size_t count, std::size_t grain, Function&& body)
+{
+    grain = std::max<std::size_t>(grain, 1);
+    const std::size_t chunks = (count + grain - 1) / grain;
+    const std::size_t workers = std::min(chunks, hardware_threads());
+    if (workers <= 1) {
+        for (std::size_t begin = 0; begin < count; begin += grain) {
+            body(begin, std::min(count, begin + grain));
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> next_chunk{0};
+    auto work = [&] {
+        for (std::size_t chunk; (chunk = next_chunk.fetch_add(1, std::memory_order_relaxed)) < chunks;) {
+            body(chunk * grain, std::min(count, (chunk + 1) * grain));
+        }
+    };
+    std::vector<std::jthread> threads;
+    threads.reserve(workers - 1);
+    for (std::size_t i = 1; i < workers; ++i) {
+        threads.emplace_back(work);
+    }
+    work();
+}
+
+} // namespace dm
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "parallel.h"
+#include "vec2.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dm {
+
+// A point file holds raw Vec2<T> records in native byte order, as written by fwrite of a std::vector<Vec2<T>>. It is
+// read through mapped windows of `window_bytes`; at most two are alive at once, the one being processed and the next
+// one being read ahead, so resident memory stays near twice the window size however large the file is. Each window is
+// processed in parallel chunks of `grain` points.
+struct PointFileOptions
+{
+    std::size_t window_bytes = std::size_t{256} << 20;
+    std::size_t grain = std::size_t{1} << 16;
+};
+
+namespace detail {
+
+template <typename T>
+[[nodiscard]] std::span<const Vec2<T>> window_points(const MappedWindow& window) noexcept
+{
+    return {reinterpret_cast<const Vec2<T>*>(window.bytes().data()), window.bytes().size() / sizeof(Vec2<T>)};
+}
+
+} // namespace detail
+
+template <typename T>
+struct PointStatistics
+{
+    std::size_t count = 0;
+    // (min corner, max corner); empty for an empty file.
+    std::optional<std::pair<Vec2<T>, Vec2<T>>> extents;
+    // Mean of the points, accumulated in double.
+    Vec2<double> centroid;
+};
+
+template <typename T>
+class PointFile
+{
+    static_assert(std::is_trivially_copyable_v<Vec2<T>> && sizeof(Vec2<T>) == 2 * sizeof(T));
+
+  public:
+    using Box = std::pair<Vec2<T>, Vec2<T>>;
+
+    explicit PointFile(const std::filesystem::path& path, PointFileOptions options = {})
+        : file_{path}, options_{options}
+    {
+    }
+
+    // Number of whole records; a trailing partial record is ignored.
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return file_.size() / sizeof(Vec2<T>);
+    }
+
+    // Calls body(points, first) over consecutive chunks covering the file, where `first` is the index of points[0] in
+    // the file. The chunks of one window run concurrently, so body must be safe to call from several threads, and the
+    // points are only valid during the call.
+    template <typename Function>
+    void for_each_chunk(Function&& body) const
+    {
+        const std::size_t count = size();
+        const std::size_t window_points = std::max<std::size_t>(options_.window_bytes / sizeof(Vec2<T>), 1);
+        MappedWindow window = map_points(0, window_points);
+        for (std::size_t first = 0; first < count; first += window_points) {
+            MappedWindow next = map_points(first + window_points, window_points);
+            const std::span<const Vec2<T>> points = detail::window_points<T>(window);
+            parallel_for(points.size(), options_.grain, [&](std::size_t begin, std::size_t end) {
+                body(points.subspan(begin, end - begin), first + begin);
+            });
+            window = std::move(next);
+        }
+    }
+
+    [[nodiscard]] PointStatistics<T> statistics() const
+    {
+        // Integer types have no infinity, and numeric_limits gives 0 for it.
+        using limits = std::numeric_limits<T>;
+        constexpr T highest = limits::has_infinity ? limits::infinity() : limits::max();
+        constexpr T lowest = limits::has_infinity ? -limits::infinity() : limits::lowest();
+        std::mutex mutex;
+        Vec2<T> min_corner(highest, highest);
+        Vec2<T> max_corner(lowest, lowest);
+        Vec2<double> sum(0.0, 0.0);
+        for_each_chunk([&](std::span<const Vec2<T>> points, std::size_t) {
+            T min_x = highest;
+            T min_y = highest;
+            T max_x = lowest;
+            T max_y = lowest;
+            double sum_x = 0;
+            double sum_y = 0;
+            for (const Vec2<T>& point : points) {
+                min_x = std::min(min_x, point.x());
+                min_y = std::min(min_y, point.y());
+                max_x = std::max(max_x, point.x());
+                max_y = std::max(max_y, point.y());
+                sum_x += point.x();
+                sum_y += point.y();
+            }
+            const std::lock_guard lock{mutex};
+            min_corner = Vec2<T>(std::min(min_corner.x(), min_x), std::min(min_corner.y(), min_y));
+            max_corner = Vec2<T>(std::max(max_corner.x(), max_x), std::max(max_corner.y(), max_y));
+            sum = Vec2<double>(sum.x() + sum_x, sum.y() + sum_y);
+        });
+
+        PointStatistics<T> statistics;
+        statistics.count = size();
+        if (statistics.count != 0) {
+            statistics.extents = Box{min_corner, max_corner};
+            statistics.centroid = sum / static_cast<double>(statistics.count);
+        }
+        return statistics;
+    }
+
+    // Point counts of a columns x rows grid laid over `box`, row-major from the min corner. Points on the max edges
+    // fall in the last column or row; points outside the box are not counted. Use rows = 1 for a histogram of x
+    // alone. Each thread counts into its own grid, so memory grows with the thread count times the grid size.
+    [[nodiscard]] std::vector<std::uint64_t> histogram(const Box& box, std::size_t columns, std::size_t rows) const
+    {
+        if (columns == 0 || rows == 0) {
+            return {};
+        }
+        // Integer coordinates are binned in double, where the scale does not truncate and offsets do not overflow.
+        using Scalar = std::conditional_t<std::is_floating_point_v<T>, T, double>;
+        const auto [min_corner, max_corner] = box;
+        const auto scale = [](Scalar width, std::size_t cells) {
+            return width > 0 ? static_cast<Scalar>(cells) / width : Scalar{0};
+        };
+        const Scalar scale_x = scale(Scalar(max_corner.x()) - Scalar(min_corner.x()), columns);
+        const Scalar scale_y = scale(Scalar(max_corner.y()) - Scalar(min_corner.y()), rows);
+
+        std::mutex mutex;
+        std::vector<std::vector<std::uint64_t>> grids;
+        std::vector<std::size_t> idle;
+        for_each_chunk([&](std::span<const Vec2<T>> points, std::size_t) {
+            std::size_t grid;
+            std::uint64_t* counts;
+            {
+                const std::lock_guard lock{mutex};
+                if (idle.empty()) {
+                    idle.push_back(grids.size());
+                    grids.emplace_back(columns * rows);
+                }
+                grid = idle.back();
+                idle.pop_back();
+                counts = grids[grid].data();
+            }
+            for (const Vec2<T>& point : points) {
+                if (point.x() >= min_corner.x() && point.x() <= max_corner.x() && point.y() >= min_corner.y() &&
+                    point.y() <= max_corner.y()) {
+                    const auto column = std::min(
+                        static_cast<std::size_t>((Scalar(point.x()) - Scalar(min_corner.x())) * scale_x), columns - 1);
+                    const auto row = std::min(
+                        static_cast<std::size_t>((Scalar(point.y()) - Scalar(min_corner.y())) * scale_y), rows - 1);
+                    ++counts[row * columns + column];
+                }
+            }
+            const std::lock_guard lock{mutex};
+            idle.push_back(grid);
+        });
+
+        std::vector<std::uint64_t> histogram(columns * rows);
+        for (const std::vector<std::uint64_t>& counts : grids) {
+            std::transform(histogram.begin(), histogram.end(), counts.begin(), histogram.begin(), std::plus<>{});
+        }
+        return histogram;
+    }
+
+  private:
+    [[nodiscard]] MappedWindow map_points(std::size_t first, std::size_t count) const
+    {
+        return file_.map(first * sizeof(Vec2<T>), count * sizeof(Vec2<T>));
+    }
+
+    MappedFile file_;
+    PointFileOptions options_;
+};
+
+} // namespace dm
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "vec2.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace dm {
+
+// Uniform grid over a point set for fixed-radius neighbour queries. Points are bucketed by a counting sort and
+// stored cell by cell, so the points of a cell are contiguous in memory. The grid is dense over the bounding box;
+// when the requested cell size would create far more cells than points, the cells are enlarged.
+template <typename T>
+class PointGrid
+{
+  public:
+    PointGrid() = default;
+
+    PointGrid(std::span<const Vec2<T>> points, double cell_size)
+    {
+        build(points, cell_size);
+    }
+
+    void build(std::span<const Vec2<T>> points, double cell_size)
+    {
+        points_.resize(points.size());
+        indices_.resize(points.size());
+        columns_ = 0;
+        rows_ = 0;
+        cell_starts_.assign(1, 0);
+        if (points.empty()) {
+            return;
+        }
+
+        const auto [min_x, max_x] =
+            std::minmax_element(points.begin(), points.end(), [](auto lhs, auto rhs) { return lhs.x() < rhs.x(); });
+        const auto [min_y, max_y] =
+            std::minmax_element(points.begin(), points.end(), [](auto lhs, auto rhs) { return lhs.y() < rhs.y(); });
+        min_x_ = min_x->x();
+        min_y_ = min_y->y();
+        const double width = static_cast<double>(max_x->x()) - min_x_;
+        const double height = static_cast<double>(max_y->y()) - min_y_;
+        const double max_cells = 4.0 * static_cast<double>(points.size()) + 64;
+        cell_size_ = std::max({cell_size, std::sqrt(width * height / max_cells), std::max(width, height) / max_cells,
+                               std::numeric_limits<double>::min()});
+        inverse_cell_size_ = 1 / cell_size_;
+        columns_ = static_cast<std::size_t>(width * inverse_cell_size_) + 1;
+        rows_ = static_cast<std::size_t>(height * inverse_cell_size_) + 1;
+
+        cell_starts_.assign(columns_ * rows_ + 1, 0);
+        std::vector<std::uint32_t> cells(points.size());
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            cells[i] = static_cast<std::uint32_t>(cell_of(points[i].x(), points[i].y()));
+            ++cell_starts_[cells[i] + 1];
+        }
+        for (std::size_t cell = 0; cell < columns_ * rows_; ++cell) {
+            cell_starts_[cell + 1] += cell_starts_[cell];
+        }
+        std::vector<std::uint32_t> cursor(cell_starts_.begin(), cell_starts_.end() - 1);
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            const std::uint32_t slot = cursor[cells[i]]++;
+            points_[slot] = points[i];
+            indices_[slot] = static_cast<std::uint32_t>(i);
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return points_.size();
+    }
+
+    // Calls function(index, point) for every point within `radius` of `center` (inclusive).
+    template <typename Function>
+    void for_each_within(const Vec2<T>& center, double radius, Function&& function) const
+    {
+        if (points_.empty()) {
+            return;
+        }
+        const double x = center.x();
+        const double y = center.y();
+        const std::size_t first_column = clamp_cell((x - radius - min_x_) * inverse_cell_size_, columns_);
+        const std::size_t last_column = clamp_cell((x + radius - min_x_) * inverse_cell_size_, columns_);
+        const std::size_t first_row = clamp_cell((y - radius - min_y_) * inverse_cell_size_, rows_);
+        const std::size_t last_row = clamp_cell((y + radius - min_y_) * inverse_cell_size_, rows_);
+        const double radius_squared = radius * radius;
+        for (std::size_t row = first_row; row <= last_row; ++row) {
+            const std::size_t begin = cell_starts_[row * columns_ + first_column];
+            const std::size_t end = cell_starts_[row * columns_ + last_column + 1];
+            for (std::size_t slot = begin; slot < end; ++slot) {
+                const double dx = static_cast<double>(points_[slot].x()) - x;
+                const double dy = static_cast<double>(points_[slot].y()) - y;
+                if (dx * dx + dy * dy <= radius_squared) {
+                    function(static_cast<std::size_t>(indices_[slot]), points_[slot]);
+                }
+            }
+        }
+    }
+
+  private:
+    double min_x_ = 0;
+    double min_y_ = 0;
+    double cell_size_ = 1;
+    double inverse_cell_size_ = 1;
+    std::size_t columns_ = 0;
+    std::size_t rows_ = 0;
+    std::vector<std::uint32_t> cell_starts_;
+    std::vector<Vec2<T>> points_;
+    std::vector<std::uint32_t> indices_;
+
+    [[nodiscard]] static std::size_t clamp_cell(double cell, std::size_t count) noexcept
+    {
+        return static_cast<std::size_t>(std::clamp(cell, 0.0, static_cast<double>(count - 1)));
+    }
+
+    [[nodiscard]] std::size_t cell_of(T x, T y) const noexcept
+    {
+        return clamp_cell((static_cast<double>(y) - min_y_) * inverse_cell_size_, rows_) * columns_ +
+               clamp_cell((static_cast<double>(x) - min_x_) * inverse_cell_size_, columns_);
+    }
+};
+
+} // namespace dm
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "fast_math.h"
+#include "parallel.h"
+#include "vec2.h"
+
+#include <cmath>
+#include <cstddef>
+
+#include <algorithm>
+#include <concepts>
+#include <span>
+
+namespace dm {
+
+// Batch conversions between cartesian and polar coordinates, with angles in radians counter-clockwise from the x
+// axis. The trigonometry is that of fast_math.h at the given Accuracy; for float, medium and high are the same and
+// within a few ulp of libm.
+
+namespace detail {
+
+inline constexpr std::size_t polar_grain = 1 << 14;
+
+template <std::floating_point T>
+[[nodiscard]] inline Vec2<T> rotated(const Vec2<T>& point, T sine, T cosine) noexcept
+{
+    // Parentheses rather than braces: the initializer_list constructor would keep the calling loop scalar.
+    return Vec2<T>(point.x() * cosine - point.y() * sine, point.x() * sine + point.y() * cosine);
+}
+
+} // namespace detail
+
+// Magnitude and angle, in [-pi, pi], of every point. The squared magnitudes must not overflow. This and the other
+// span functions below process their spans up to the shortest of them.
+template <Accuracy A = Accuracy::high, std::floating_point T>
+void to_polar(std::span<const Vec2<T>> points, std::span<T> magnitudes, std::span<T> angles)
+{
+    const std::size_t count = std::min({points.size(), magnitudes.size(), angles.size()});
+    parallel_for(count, detail::polar_grain, [=](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const T x = points[i].x();
+            const T y = points[i].y();
+            magnitudes[i] = fast_sqrt<A>(x * x + y * y);
+            angles[i] = fast_atan2<A>(y, x);
+        }
+    });
+}
+
+template <Accuracy A = Accuracy::high, std::floating_point T>
+void from_polar(std::span<const T> magnitudes, std::span<const T> angles, std::span<Vec2<T>> points)
+{
+    const std::size_t count = std::min({magnitudes.size(), angles.size(), points.size()});
+    parallel_for(count, detail::polar_grain, [=](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const auto [sine, cosine] = fast_sin_cos<A>(angles[i]);
+            points[i] = Vec2<T>(magnitudes[i] * cosine, magnitudes[i] * sine);
+        }
+    });
+}
+
+// Rotates every point about the origin by the angle with the same index.
+template <Accuracy A = Accuracy::high, std::floating_point T>
+void rotate(std::span<Vec2<T>> points, std::span<const T> angles)
+{
+    const std::size_t count = std::min(points.size(), angles.size());
+    parallel_for(count, detail::polar_grain, [=](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const auto [sine, cosine] = fast_sin_cos<A>(angles[i]);
+            points[i] = detail::rotated(points[i], sine, cosine);
+        }
+    });
+}
+
+// Rotates every point about the origin by `angle`.
+template <std::floating_point T>
+void rotate(std::span<Vec2<T>> points, T angle)
+{
+    const T sine = std::sin(angle);
+    const T cosine = std::cos(angle);
+    parallel_for(points.size(), detail::polar_grain, [=](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            points[i] = detail::rotated(points[i], sine, cosine);
+        }
+    });
+}
+
+} // namespace dm
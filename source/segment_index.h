@@ -0,0 +1,136 @@
+#pragma once
+
+#include "morton.h"
+#include "packed_rtree.h"
+#include "parallel.h"
+#include "vec2.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dm {
+
+// Closest point of a segment: `point` = a + t * (b - a) with t in [0, 1]. For integer T, `point` is rounded to the
+// nearest grid point while `t` stays exact.
+template <typename T>
+struct SegmentMatch
+{
+    static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+    std::uint32_t segment = none;
+    Vec2<T> point;
+    double t = 0;
+};
+
+// Nearest-segment queries over a fixed set of (a, b) segments, such as the edges of a road network, indexed by a
+// packed R-tree of their bounding boxes.
+template <typename T>
+class SegmentIndex
+{
+  public:
+    using Segment = std::pair<Vec2<T>, Vec2<T>>;
+
+    explicit SegmentIndex(std::span<const Segment> segments) : segments_(segments.begin(), segments.end())
+    {
+        std::vector<typename PackedRTree<T>::Box> boxes(segments_.size());
+        std::transform(segments_.begin(), segments_.end(), boxes.begin(), [](const Segment& segment) {
+            return typename PackedRTree<T>::Box{
+                {std::min(segment.first.x(), segment.second.x()), std::min(segment.first.y(), segment.second.y())},
+                {std::max(segment.first.x(), segment.second.x()), std::max(segment.first.y(), segment.second.y())}};
+        });
+        tree_.build(boxes);
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return segments_.size();
+    }
+
+    // Nearest segment to `point` within `max_distance`; the match has no segment if there is none.
+    [[nodiscard]] SegmentMatch<T> nearest(const Vec2<T>& point,
+                                          double max_distance = std::numeric_limits<double>::infinity()) const
+    {
+        std::vector<std::pair<double, std::uint32_t>> queue;
+        return nearest(point, max_distance * max_distance, SegmentMatch<T>::none, queue);
+    }
+
+    // Nearest segment to each point, written to the match with the same index. The queries are answered in Morton
+    // order of the points, so consecutive queries walk the same part of the tree, and each one starts with the
+    // previous answer as its upper bound.
+    void nearest(std::span<const Vec2<T>> points, std::span<SegmentMatch<T>> matches,
+                 double max_distance = std::numeric_limits<double>::infinity()) const
+    {
+        const std::vector<std::uint32_t> order = morton_order(points);
+        const double max_distance_squared = max_distance * max_distance;
+        parallel_for(order.size(), 1024, [&](std::size_t begin, std::size_t end) {
+            std::vector<std::pair<double, std::uint32_t>> queue;
+            std::uint32_t previous = SegmentMatch<T>::none;
+            for (std::size_t i = begin; i < end; ++i) {
+                const std::uint32_t index = order[i];
+                matches[index] = nearest(points[index], max_distance_squared, previous, queue);
+                if (matches[index].segment != SegmentMatch<T>::none) {
+                    previous = matches[index].segment;
+                }
+            }
+        });
+    }
+
+  private:
+    std::vector<Segment> segments_;
+    PackedRTree<T> tree_;
+
+    // Projection of `point` onto segment `index` and its squared distance.
+    [[nodiscard]] std::pair<SegmentMatch<T>, double> project(const Vec2<T>& point, std::uint32_t index) const noexcept
+    {
+        const Segment& segment = segments_[index];
+        const double ax = static_cast<double>(segment.first.x());
+        const double ay = static_cast<double>(segment.first.y());
+        const double dx = static_cast<double>(segment.second.x()) - ax;
+        const double dy = static_cast<double>(segment.second.y()) - ay;
+        const double px = static_cast<double>(point.x()) - ax;
+        const double py = static_cast<double>(point.y()) - ay;
+        const double length_squared = dx * dx + dy * dy;
+        const double t = (length_squared > 0) ? std::clamp((px * dx + py * dy) / length_squared, 0.0, 1.0) : 0.0;
+        const double ex = px - t * dx;
+        const double ey = py - t * dy;
+        return {{index, {to_coordinate(ax + t * dx), to_coordinate(ay + t * dy)}, t}, ex * ex + ey * ey};
+    }
+
+    [[nodiscard]] static T to_coordinate(double value) noexcept
+    {
+        if constexpr (std::is_integral_v<T>) {
+            return static_cast<T>(std::llround(value));
+        } else {
+            return static_cast<T>(value);
+        }
+    }
+
+    // `hint` is a segment likely to be near `point`; its distance bounds the search from the start.
+    [[nodiscard]] SegmentMatch<T> nearest(const Vec2<T>& point, double max_distance_squared, std::uint32_t hint,
+                                          std::vector<std::pair<double, std::uint32_t>>& queue) const
+    {
+        // Limits are inclusive while the tree only reports strictly closer items.
+        std::uint32_t best = SegmentMatch<T>::none;
+        double bound = std::nextafter(max_distance_squared, std::numeric_limits<double>::infinity());
+        if (hint != SegmentMatch<T>::none) {
+            const double hint_distance = project(point, hint).second;
+            if (hint_distance < bound) {
+                best = hint;
+                bound = hint_distance;
+            }
+        }
+        auto distance = [&](std::uint32_t index) { return project(point, index).second; };
+        best = tree_.nearest(point, distance, queue, best, bound).first;
+        return (best == SegmentMatch<T>::none) ? SegmentMatch<T>{} : project(point, best).first;
+    }
+};
+
+} // namespace dm
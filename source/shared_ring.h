@@ -0,0 +1,450 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "vec2.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace dm {
+
+// A ring of fixed-capacity batches of points in shared memory, written by one producer and read by up to max_readers
+// consumers, each of which sees every batch: with one reader it is a single-producer single-consumer queue. Batches
+// are written and read in place, so neither side copies or serializes. Waiting, on either side, sleeps on a futex in
+// the shared memory, and the system call is only made when someone is actually asleep.
+//
+// The writer waits while the slowest reader is a whole ring behind. A reader that dies without detaching therefore
+// stalls it once the ring fills; a writer that must not block can use try_acquire and drop batches instead.
+
+namespace detail {
+
+inline constexpr std::size_t cache_line = 64;
+inline constexpr std::uint64_t ring_magic = 0x31676e6972326d64; // "dm2ring1"
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free && sizeof(std::atomic<std::uint32_t>) == 4);
+
+inline void futex_wait(std::atomic<std::uint32_t>& word, std::uint32_t expected) noexcept
+{
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT, expected, nullptr, nullptr, 0);
+}
+
+inline void futex_wake(std::atomic<std::uint32_t>& word) noexcept
+{
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+// Something to wait for across processes. Every notification changes `sequence`, the futex word, so a waiter that
+// read it before checking its condition cannot miss a notification that comes after.
+struct alignas(cache_line) SharedEvent
+{
+    std::atomic<std::uint32_t> sequence;
+    std::atomic<std::uint32_t> waiters;
+
+    template <typename Ready>
+    void wait_until(Ready&& ready) noexcept
+    {
+        while (!ready()) {
+            waiters.fetch_add(1);
+            const std::uint32_t seen = sequence.load();
+            if (!ready()) {
+                futex_wait(sequence, seen);
+            }
+            waiters.fetch_sub(1);
+        }
+    }
+
+    void notify() noexcept
+    {
+        sequence.fetch_add(1);
+        if (waiters.load() != 0) {
+            futex_wake(sequence);
+        }
+    }
+};
+
+struct alignas(cache_line) PaddedCounter
+{
+    std::atomic<std::uint32_t> value;
+};
+
+struct RingHeader
+{
+    std::uint64_t magic;
+    std::uint32_t point_size;
+    std::uint32_t slot_count;
+    std::uint32_t batch_capacity;
+    std::uint32_t max_readers;
+    std::atomic<std::uint32_t> closed;
+    // Batches published so far, modulo 2^32. Only the writer changes it.
+    PaddedCounter written;
+    SharedEvent published;
+    SharedEvent consumed;
+};
+
+enum : std::uint32_t
+{
+    cursor_free = 0,
+    cursor_joining = 1,
+    cursor_active = 2,
+};
+
+// One per reader: the next batch it will read, on a cache line of its own.
+struct alignas(cache_line) RingCursor
+{
+    std::atomic<std::uint32_t> position;
+    std::atomic<std::uint32_t> state;
+};
+
+struct alignas(cache_line) SlotHeader
+{
+    std::uint32_t count;
+};
+
+[[nodiscard]] constexpr std::size_t round_to_cache_line(std::size_t bytes) noexcept
+{
+    return (bytes + cache_line - 1) / cache_line * cache_line;
+}
+
+} // namespace detail
+
+template <typename T>
+class SharedRing
+{
+    static_assert(std::is_trivially_copyable_v<Vec2<T>>);
+
+  public:
+    // A ring in a new POSIX shared memory object; slot_count is rounded up to a power of two. Throws
+    // std::system_error, with EEXIST if the name is taken.
+    [[nodiscard]] static SharedRing create(const std::string& name, std::uint32_t slot_count,
+                                           std::uint32_t batch_capacity, std::uint32_t max_readers = 1)
+    {
+        const int descriptor = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+        if (descriptor < 0) {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        }
+        try {
+            return SharedRing{FileDescriptor{descriptor}, slot_count, batch_capacity, max_readers};
+        } catch (...) {
+            unlink(name);
+            throw;
+        }
+    }
+
+    // A ring in an anonymous memfd, shared by passing descriptor() to the other processes, by fork or over a Unix
+    // socket, and attaching there.
+    [[nodiscard]] static SharedRing create_anonymous(std::uint32_t slot_count, std::uint32_t batch_capacity,
+                                                     std::uint32_t max_readers = 1)
+    {
+        const int descriptor = ::memfd_create("dm-shared-ring", MFD_CLOEXEC);
+        if (descriptor < 0) {
+            throw std::system_error(errno, std::generic_category(), "memfd_create");
+        }
+        return SharedRing{FileDescriptor{descriptor}, slot_count, batch_capacity, max_readers};
+    }
+
+    // The ring created under `name`. Throws std::system_error, with EINVAL if it is not a ring of Vec2<T>.
+    [[nodiscard]] static SharedRing open(const std::string& name)
+    {
+        const int descriptor = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+        if (descriptor < 0) {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        }
+        return SharedRing{FileDescriptor{descriptor}};
+    }
+
+    [[nodiscard]] static SharedRing attach(FileDescriptor descriptor)
+    {
+        return SharedRing{std::move(descriptor)};
+    }
+
+    // Removes the name; the memory lives on while any process has the ring mapped.
+    static void unlink(const std::string& name) noexcept
+    {
+        ::shm_unlink(name.c_str());
+    }
+
+    SharedRing(SharedRing&& other) noexcept
+        : file_{std::move(other.file_)}, memory_{std::exchange(other.memory_, nullptr)},
+          size_{std::exchange(other.size_, 0)}
+    {
+    }
+
+    SharedRing& operator=(SharedRing&& other) noexcept
+    {
+        std::swap(file_, other.file_);
+        std::swap(memory_, other.memory_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    ~SharedRing()
+    {
+        if (memory_ != nullptr) {
+            ::munmap(memory_, size_);
+        }
+    }
+
+    [[nodiscard]] int descriptor() const noexcept
+    {
+        return file_.get();
+    }
+
+    [[nodiscard]] std::uint32_t slot_count() const noexcept
+    {
+        return header().slot_count;
+    }
+
+    [[nodiscard]] std::uint32_t batch_capacity() const noexcept
+    {
+        return header().batch_capacity;
+    }
+
+  private:
+    template <typename>
+    friend class RingWriter;
+    template <typename>
+    friend class RingReader;
+
+    FileDescriptor file_;
+    void* memory_ = nullptr;
+    std::size_t size_ = 0;
+
+    [[nodiscard]] static std::size_t slot_bytes(std::uint32_t batch_capacity) noexcept
+    {
+        return detail::round_to_cache_line(sizeof(detail::SlotHeader) + batch_capacity * sizeof(Vec2<T>));
+    }
+
+    [[nodiscard]] static std::size_t ring_bytes(std::uint32_t slot_count, std::uint32_t batch_capacity,
+                                                std::uint32_t max_readers) noexcept
+    {
+        return detail::round_to_cache_line(sizeof(detail::RingHeader)) + max_readers * sizeof(detail::RingCursor) +
+               slot_count * slot_bytes(batch_capacity);
+    }
+
+    SharedRing(FileDescriptor file, std::uint32_t slot_count, std::uint32_t batch_capacity, std::uint32_t max_readers)
+        : file_{std::move(file)}
+    {
+        slot_count = std::bit_ceil(std::max<std::uint32_t>(slot_count, 1));
+        batch_capacity = std::max<std::uint32_t>(batch_capacity, 1);
+        max_readers = std::max<std::uint32_t>(max_readers, 1);
+        const std::size_t size = ring_bytes(slot_count, batch_capacity, max_readers);
+        if (::ftruncate(file_.get(), static_cast<off_t>(size)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "ftruncate");
+        }
+        map(size);
+        // The new memory is zeroed, which is the initial state of every counter, cursor and event.
+        detail::RingHeader& ring = header();
+        ring.point_size = sizeof(Vec2<T>);
+        ring.slot_count = slot_count;
+        ring.batch_capacity = batch_capacity;
+        ring.max_readers = max_readers;
+        std::atomic_ref{ring.magic}.store(detail::ring_magic, std::memory_order_release);
+    }
+
+    explicit SharedRing(FileDescriptor file) : file_{std::move(file)}
+    {
+        struct stat status{};
+        if (::fstat(file_.get(), &status) != 0) {
+            throw std::system_error(errno, std::generic_category(), "fstat");
+        }
+        const auto size = static_cast<std::size_t>(status.st_size);
+        if (size < sizeof(detail::RingHeader)) {
+            throw std::system_error(EINVAL, std::generic_category(), "not a shared ring");
+        }
+        map(size);
+        detail::RingHeader& ring = header();
+        if (std::atomic_ref{ring.magic}.load(std::memory_order_acquire) != detail::ring_magic ||
+            ring.point_size != sizeof(Vec2<T>) || !std::has_single_bit(ring.slot_count) ||
+            size < ring_bytes(ring.slot_count, ring.batch_capacity, ring.max_readers)) {
+            throw std::system_error(EINVAL, std::generic_category(), "not a shared ring of this point type");
+        }
+    }
+
+    void map(std::size_t size)
+    {
+        void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file_.get(), 0);
+        if (memory == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap");
+        }
+        memory_ = memory;
+        size_ = size;
+    }
+
+    [[nodiscard]] detail::RingHeader& header() const noexcept
+    {
+        return *static_cast<detail::RingHeader*>(memory_);
+    }
+
+    [[nodiscard]] std::span<detail::RingCursor> cursors() const noexcept
+    {
+        auto* first = reinterpret_cast<detail::RingCursor*>(static_cast<std::byte*>(memory_) +
+                                                            detail::round_to_cache_line(sizeof(detail::RingHeader)));
+        return {first, header().max_readers};
+    }
+
+    [[nodiscard]] detail::SlotHeader& slot(std::uint32_t sequence) const noexcept
+    {
+        std::byte* slots = reinterpret_cast<std::byte*>(cursors().data() + header().max_readers);
+        return *reinterpret_cast<detail::SlotHeader*>(slots + (sequence & (header().slot_count - 1)) *
+                                                                  slot_bytes(header().batch_capacity));
+    }
+
+    [[nodiscard]] Vec2<T>* slot_points(std::uint32_t sequence) const noexcept
+    {
+        return reinterpret_cast<Vec2<T>*>(&slot(sequence) + 1);
+    }
+};
+
+// The producer side of a ring; there must be only one at a time.
+template <typename T>
+class RingWriter
+{
+  public:
+    explicit RingWriter(SharedRing<T>& ring) noexcept : ring_{ring}
+    {
+    }
+
+    // The slot for the next batch, with room for batch_capacity() points, waiting while the slowest reader is a whole
+    // ring behind.
+    [[nodiscard]] std::span<Vec2<T>> acquire() noexcept
+    {
+        ring_.header().consumed.wait_until([&] { return has_room(); });
+        return {ring_.slot_points(sequence()), ring_.batch_capacity()};
+    }
+
+    // As acquire, but empty instead of waiting.
+    [[nodiscard]] std::optional<std::span<Vec2<T>>> try_acquire() noexcept
+    {
+        if (!has_room()) {
+            return std::nullopt;
+        }
+        return std::span<Vec2<T>>{ring_.slot_points(sequence()), ring_.batch_capacity()};
+    }
+
+    // Hands the first `count` points written to the acquired slot to the readers.
+    void publish(std::size_t count) noexcept
+    {
+        detail::RingHeader& header = ring_.header();
+        ring_.slot(sequence()).count = static_cast<std::uint32_t>(std::min<std::size_t>(count, ring_.batch_capacity()));
+        header.written.value.store(sequence() + 1);
+        header.published.notify();
+    }
+
+    // Copies `points` into as many batches as they need, waiting for room as acquire does.
+    void publish(std::span<const Vec2<T>> points) noexcept
+    {
+        while (!points.empty()) {
+            const std::span<Vec2<T>> batch = acquire();
+            const std::size_t count = std::min(points.size(), batch.size());
+            std::copy_n(points.begin(), count, batch.begin());
+            publish(count);
+            points = points.subspan(count);
+        }
+    }
+
+    // Tells the readers that no more batches will come; they still get those already published.
+    void close() noexcept
+    {
+        ring_.header().closed.store(1);
+        ring_.header().published.notify();
+    }
+
+  private:
+    SharedRing<T>& ring_;
+
+    [[nodiscard]] std::uint32_t sequence() const noexcept
+    {
+        return ring_.header().written.value.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool has_room() const noexcept
+    {
+        const std::uint32_t next = sequence();
+        const std::uint32_t slots = ring_.slot_count();
+        return std::all_of(ring_.cursors().begin(), ring_.cursors().end(), [&](const detail::RingCursor& cursor) {
+            return cursor.state.load() != detail::cursor_active || next - cursor.position.load() < slots;
+        });
+    }
+};
+
+// A consumer of a ring, which sees every batch published after it joins. Throws std::system_error with EAGAIN if the
+// ring already has max_readers readers.
+template <typename T>
+class RingReader
+{
+  public:
+    explicit RingReader(SharedRing<T>& ring) : ring_{ring}
+    {
+        detail::RingHeader& header = ring_.header();
+        for (detail::RingCursor& cursor : ring_.cursors()) {
+            std::uint32_t state = detail::cursor_free;
+            if (cursor.state.compare_exchange_strong(state, detail::cursor_joining)) {
+                cursor_ = &cursor;
+                break;
+            }
+        }
+        if (cursor_ == nullptr) {
+            throw std::system_error(EAGAIN, std::generic_category(), "shared ring has no free reader slot");
+        }
+        // The writer takes no notice of a joining cursor, so its position is set before it becomes active, and set
+        // again after, to skip any batches the writer published in between without waiting for them.
+        cursor_->position.store(header.written.value.load());
+        cursor_->state.store(detail::cursor_active);
+        cursor_->position.store(header.written.value.load());
+        header.consumed.notify();
+    }
+
+    RingReader(const RingReader&) = delete;
+    RingReader& operator=(const RingReader&) = delete;
+
+    ~RingReader()
+    {
+        cursor_->state.store(detail::cursor_free);
+        ring_.header().consumed.notify();
+    }
+
+    // The next batch, waiting for it to be published, and valid until the next call; empty once the writer has
+    // closed the ring and every batch has been read. Calling next gives the previous batch back to the writer.
+    [[nodiscard]] std::optional<std::span<const Vec2<T>>> next() noexcept
+    {
+        detail::RingHeader& header = ring_.header();
+        std::uint32_t position = cursor_->position.load(std::memory_order_relaxed);
+        if (holding_) {
+            cursor_->position.store(++position);
+            header.consumed.notify();
+            holding_ = false;
+        }
+        header.published.wait_until([&] { return header.written.value.load() != position || header.closed.load(); });
+        if (header.written.value.load() == position) {
+            return std::nullopt;
+        }
+        holding_ = true;
+        return std::span<const Vec2<T>>{ring_.slot_points(position), ring_.slot(position).count};
+    }
+
+  private:
+    SharedRing<T>& ring_;
+    detail::RingCursor* cursor_ = nullptr;
+    bool holding_ = false;
+};
+
+} // namespace dm
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "morton.h"
+#include "packed_rtree.h"
+#include "parallel.h"
+#include "vec2.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace dm {
+
+// (point, polygon) index pairs stored column by column.
+struct JoinPairs
+{
+    std::vector<std::uint32_t> points;
+    std::vector<std::uint32_t> polygons;
+};
+
+// Point-in-polygon join against a fixed set of simple polygons, one ring each. Polygon bounding boxes go into a packed
+// R-tree; each candidate from the tree is confirmed with a crossing-number test that only looks at the edges in the
+// horizontal band of the polygon containing the point. The test is half-open, so a point on an edge shared by two
+// polygons is assigned to exactly one of them.
+template <typename T>
+class PolygonJoin
+{
+  public:
+    explicit PolygonJoin(std::span<const std::vector<Vec2<T>>> polygons)
+    {
+        std::vector<typename PackedRTree<T>::Box> boxes;
+        boxes.reserve(polygons.size());
+        ring_offsets_.push_back(0);
+        band_offsets_.push_back(0);
+        for (const auto& ring : polygons) {
+            vertices_.insert(vertices_.end(), ring.begin(), ring.end());
+            ring_offsets_.push_back(static_cast<std::uint32_t>(vertices_.size()));
+            boxes.push_back(add_bands(ring_offsets_[ring_offsets_.size() - 2], ring_offsets_.back()));
+        }
+        tree_.build(boxes);
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return bands_.size();
+    }
+
+    [[nodiscard]] bool contains(std::uint32_t polygon, const Vec2<T>& point) const noexcept
+    {
+        const Bands& bands = bands_[polygon];
+        const double y = static_cast<double>(point.y());
+        const double band = (y - bands.min_y) * bands.scale;
+        if (!(band >= 0 && band < bands.count)) {
+            return false;
+        }
+        const std::uint32_t ring_begin = ring_offsets_[polygon];
+        const std::uint32_t ring_end = ring_offsets_[polygon + 1];
+        const double x = static_cast<double>(point.x());
+        const std::size_t slot = bands.first + static_cast<std::size_t>(band);
+        bool inside = false;
+        for (std::uint32_t i = band_offsets_[slot]; i < band_offsets_[slot + 1]; ++i) {
+            const std::uint32_t edge = band_edges_[i];
+            const Vec2<T>* a = &vertices_[edge];
+            const Vec2<T>* b = &vertices_[(edge + 1 == ring_end) ? ring_begin : edge + 1];
+            // Evaluate every edge from its lower end, so the neighbours sharing it round the crossing identically.
+            if (a->y() > b->y()) {
+                std::swap(a, b);
+            }
+            const double ay = static_cast<double>(a->y());
+            const double by = static_cast<double>(b->y());
+            if (ay <= y && y < by) {
+                const double ax = static_cast<double>(a->x());
+                const double bx = static_cast<double>(b->x());
+                if (x < ax + (y - ay) * (bx - ax) / (by - ay)) {
+                    inside = !inside;
+                }
+            }
+        }
+        return inside;
+    }
+
+    // Every (point, polygon) pair with the point inside the polygon. Points are probed in Morton order, in parallel
+    // chunks, and the pairs come out grouped in that order.
+    void join(std::span<const Vec2<T>> points, JoinPairs& output) const
+    {
+        const std::vector<std::uint32_t> order = morton_order(points);
+        const std::size_t chunks = (order.size() + join_grain - 1) / join_grain;
+        std::vector<JoinPairs> partial(chunks);
+        parallel_for(order.size(), join_grain, [&](std::size_t begin, std::size_t end) {
+            JoinPairs& pairs = partial[begin / join_grain];
+            for (std::size_t i = begin; i < end; ++i) {
+                const std::uint32_t index = order[i];
+                tree_.for_each_containing(points[index], [&](std::size_t polygon) {
+                    if (contains(static_cast<std::uint32_t>(polygon), points[index])) {
+                        pairs.points.push_back(index);
+                        pairs.polygons.push_back(static_cast<std::uint32_t>(polygon));
+                    }
+                });
+            }
+        });
+
+        std::vector<std::size_t> offsets(chunks + 1, 0);
+        for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+            offsets[chunk + 1] = offsets[chunk] + partial[chunk].points.size();
+        }
+        output.points.resize(offsets.back());
+        output.polygons.resize(offsets.back());
+        parallel_for(chunks, 16, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t chunk = begin; chunk < end; ++chunk) {
+                std::copy(partial[chunk].points.begin(), partial[chunk].points.end(),
+                          output.points.begin() + offsets[chunk]);
+                std::copy(partial[chunk].polygons.begin(), partial[chunk].polygons.end(),
+                          output.polygons.begin() + offsets[chunk]);
+            }
+        });
+    }
+
+  private:
+    static constexpr std::size_t join_grain = 4096;
+    static constexpr std::uint32_t edges_per_band = 8;
+
+    // Horizontal bands of one polygon's bounding box, each listing the edges that reach into it.
+    struct Bands
+    {
+        double min_y;
+        double scale;
+        std::uint32_t count;
+        std::uint32_t first;
+    };
+
+    std::vector<Vec2<T>> vertices_;
+    std::vector<std::uint32_t> ring_offsets_;
+    std::vector<Bands> bands_;
+    std::vector<std::uint32_t> band_offsets_;
+    std::vector<std::uint32_t> band_edges_;
+    PackedRTree<T> tree_;
+
+    typename PackedRTree<T>::Box add_bands(std::uint32_t begin, std::uint32_t end)
+    {
+        typename PackedRTree<T>::Box box{};
+        Bands bands{0, 0, 0, static_cast<std::uint32_t>(band_offsets_.size() - 1)};
+        if (end - begin < 3) {
+            bands_.push_back(bands);
+            return box;
+        }
+        box = {vertices_[begin], vertices_[begin]};
+        for (std::uint32_t i = begin + 1; i < end; ++i) {
+            box.first = {std::min(box.first.x(), vertices_[i].x()), std::min(box.first.y(), vertices_[i].y())};
+            box.second = {std::max(box.second.x(), vertices_[i].x()), std::max(box.second.y(), vertices_[i].y())};
+        }
+        bands.min_y = static_cast<double>(box.first.y());
+        const double height = static_cast<double>(box.second.y()) - bands.min_y;
+        bands.count = (height > 0) ? std::max<std::uint32_t>((end - begin) / edges_per_band, 1) : 1;
+        bands.scale = (height > 0) ? bands.count / height : 0;
+
+        // Counting sort of the edges into the bands they overlap.
+        auto band_range = [&](std::uint32_t edge) {
+            const double ay = static_cast<double>(vertices_[edge].y());
+            const double by = static_cast<double>(vertices_[(edge + 1 == end) ? begin : edge + 1].y());
+            const auto band = [&](double y) {
+                return std::min(static_cast<std::uint32_t>((y - bands.min_y) * bands.scale), bands.count - 1);
+            };
+            return std::pair{band(std::min(ay, by)), band(std::max(ay, by))};
+        };
+        std::vector<std::uint32_t> counts(bands.count + 1, 0);
+        for (std::uint32_t edge = begin; edge < end; ++edge) {
+            const auto [low, high] = band_range(edge);
+            for (std::uint32_t band = low; band <= high; ++band) {
+                ++counts[band + 1];
+            }
+        }
+        const std::uint32_t base = band_offsets_.back();
+        for (std::uint32_t band = 0; band < bands.count; ++band) {
+            counts[band + 1] += counts[band];
+            band_offsets_.push_back(base + counts[band + 1]);
+        }
+        band_edges_.resize(base + counts.back());
+        for (std::uint32_t edge = begin; edge < end; ++edge) {
+            const auto [low, high] = band_range(edge);
+            for (std::uint32_t band = low; band <= high; ++band) {
+                band_edges_[base + counts[band]++] = edge;
+            }
+        }
+        bands_.push_back(bands);
+        return box;
+    }
+};
+
+} // namespace dm
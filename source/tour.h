@@ -0,0 +1,272 @@
+#pragma once
+
+#include "kd_tree.h"
+#include "parallel.h"
+#include "vec2.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace dm {
+
+struct TourOptions
+{
+    // Nearest neighbours of every stop that moves may connect it to.
+    std::size_t neighbors = 10;
+    // Also try moving segments of up to three stops elsewhere in the tour.
+    bool or_opt = true;
+};
+
+// Local search for closed tours over a fixed set of stops, in the style of Bentley's 2-opt and Or-opt. Moves only add
+// edges between a stop and one of its precomputed nearest neighbours, and a stop whose surroundings have not changed
+// since its last unsuccessful scan is not scanned again (its don't-look bit is set). The tour is an array of stops
+// with an inverse position array; a 2-opt move reverses whichever side of the cut is shorter, and an Or-opt move is
+// done as two or three 2-opt moves.
+template <typename T>
+class TourImprover
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    explicit TourImprover(std::span<const Vec2<T>> stops, TourOptions options = {})
+        : stops_(stops.begin(), stops.end()), options_{options}
+    {
+        const std::size_t n = stops_.size();
+        candidate_count_ = std::min(options_.neighbors, (n > 0) ? n - 1 : 0);
+        candidates_.resize(n * candidate_count_);
+        const KdTree<T> tree{stops};
+        parallel_for(n, 1024, [&](std::size_t begin, std::size_t end) {
+            std::vector<std::pair<T, std::uint32_t>> nearest;
+            for (std::size_t i = begin; i < end; ++i) {
+                tree.nearest(stops_[i], candidate_count_, nearest, static_cast<std::uint32_t>(i));
+                for (std::size_t j = 0; j < nearest.size(); ++j) {
+                    candidates_[i * candidate_count_ + j] = nearest[j].second;
+                }
+            }
+        });
+    }
+
+    [[nodiscard]] double length(std::span<const std::uint32_t> tour) const noexcept
+    {
+        double total = 0;
+        for (std::size_t i = 0; i < tour.size(); ++i) {
+            total += distance(tour[i], tour[(i + 1) % tour.size()]);
+        }
+        return total;
+    }
+
+    // Improves `tour`, a permutation of all stop indices, until no candidate move shortens it or `budget` runs out.
+    // Returns the length of the resulting tour.
+    double improve(std::span<std::uint32_t> tour, clock::duration budget = clock::duration::max())
+    {
+        const std::size_t n = tour.size();
+        if (n < 5) {
+            return length(tour);
+        }
+        const clock::time_point start = clock::now();
+        const clock::time_point deadline = (budget >= clock::time_point::max() - start) ? clock::time_point::max()
+                                                                                         : start + budget;
+        order_.assign(tour.begin(), tour.end());
+        position_.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            position_[order_[i]] = static_cast<std::uint32_t>(i);
+        }
+        queued_.assign(n, 1);
+        queue_.assign(order_.begin(), order_.end());
+
+        for (std::size_t scanned = 1; !queue_.empty(); ++scanned) {
+            if (scanned % deadline_check_interval == 0 && clock::now() >= deadline) {
+                break;
+            }
+            const std::uint32_t stop = queue_.front();
+            queue_.pop_front();
+            queued_[stop] = 0;
+            if (two_opt(stop) || (options_.or_opt && or_opt(stop))) {
+                activate(stop);
+            }
+        }
+        std::copy(order_.begin(), order_.end(), tour.begin());
+        return length(tour);
+    }
+
+  private:
+    static constexpr std::size_t deadline_check_interval = 8;
+    static constexpr double tolerance = 1e-10;
+    static constexpr std::size_t max_segment = 3;
+
+    std::vector<Vec2<T>> stops_;
+    TourOptions options_;
+    std::size_t candidate_count_ = 0;
+    std::vector<std::uint32_t> candidates_;
+    std::vector<std::uint32_t> order_;
+    std::vector<std::uint32_t> position_;
+    std::vector<std::uint8_t> queued_;
+    std::deque<std::uint32_t> queue_;
+
+    [[nodiscard]] double distance(std::uint32_t a, std::uint32_t b) const noexcept
+    {
+        const double dx = static_cast<double>(stops_[a].x()) - static_cast<double>(stops_[b].x());
+        const double dy = static_cast<double>(stops_[a].y()) - static_cast<double>(stops_[b].y());
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+    [[nodiscard]] std::span<const std::uint32_t> candidates(std::uint32_t stop) const noexcept
+    {
+        return std::span<const std::uint32_t>{candidates_}.subspan(stop * candidate_count_, candidate_count_);
+    }
+
+    [[nodiscard]] std::uint32_t next(std::uint32_t stop) const noexcept
+    {
+        const std::uint32_t position = position_[stop] + 1;
+        return order_[(position == order_.size()) ? 0 : position];
+    }
+
+    [[nodiscard]] std::uint32_t previous(std::uint32_t stop) const noexcept
+    {
+        const std::uint32_t position = position_[stop];
+        return order_[(position == 0) ? order_.size() - 1 : position - 1];
+    }
+
+    // Clears the don't-look bit of `stop`.
+    void activate(std::uint32_t stop)
+    {
+        if (!queued_[stop]) {
+            queued_[stop] = 1;
+            queue_.push_back(stop);
+        }
+    }
+
+    // Reverses the stops at positions [first, last], cyclically. If that is more than half the tour, the rest of the
+    // tour is reversed instead, which leaves the same cycle.
+    void reverse(std::size_t first, std::size_t last) noexcept
+    {
+        const std::size_t n = order_.size();
+        std::size_t count = (last + n - first) % n + 1;
+        if (2 * count > n) {
+            std::swap(first, last);
+            first = (first + 1) % n;
+            last = (last + n - 1) % n;
+            count = n - count;
+        }
+        for (std::size_t i = 0; i < count / 2; ++i) {
+            std::swap(order_[first], order_[last]);
+            position_[order_[first]] = static_cast<std::uint32_t>(first);
+            position_[order_[last]] = static_cast<std::uint32_t>(last);
+            first = (first + 1 == n) ? 0 : first + 1;
+            last = (last == 0) ? n - 1 : last - 1;
+        }
+    }
+
+    // Replaces tour edges (a, b) and (c, d) by (a, c) and (b, d). The edges must be traversed in the same direction,
+    // a -> b ... c -> d or b -> a ... d -> c.
+    void move(std::uint32_t a, std::uint32_t b, std::uint32_t c, std::uint32_t d) noexcept
+    {
+        if (next(a) == b) {
+            reverse(position_[b], position_[c]);
+        } else {
+            reverse(position_[a], position_[d]);
+        }
+    }
+
+    bool two_opt(std::uint32_t a)
+    {
+        for (const bool forward : {true, false}) {
+            const std::uint32_t b = forward ? next(a) : previous(a);
+            const double removed = distance(a, b);
+            for (const std::uint32_t c : candidates(a)) {
+                const double added = distance(a, c);
+                if (added >= removed) {
+                    break;
+                }
+                const std::uint32_t d = forward ? next(c) : previous(c);
+                if (c == b || d == a) {
+                    continue;
+                }
+                const double delta = added + distance(b, d) - removed - distance(c, d);
+                if (delta < -tolerance * removed) {
+                    move(a, b, c, d);
+                    activate(b);
+                    activate(c);
+                    activate(d);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Moves a segment of up to three stops that starts or ends at `a` next to one of the candidates of `a`, in either
+    // orientation.
+    bool or_opt(std::uint32_t a)
+    {
+        const std::size_t n = order_.size();
+        for (std::size_t length = 1; length <= max_segment && length + 3 <= n; ++length) {
+            for (const bool forward : {true, false}) {
+                std::uint32_t s1 = a;
+                std::uint32_t s2 = a;
+                for (std::size_t i = 1; i < length; ++i) {
+                    (forward ? s2 : s1) = forward ? next(s2) : previous(s1);
+                }
+                const std::uint32_t p = previous(s1);
+                const std::uint32_t q = next(s2);
+                const double removed = distance(p, s1) + distance(s2, q) - distance(p, q);
+                if (removed <= 0) {
+                    continue;
+                }
+                for (const std::uint32_t c : candidates(a)) {
+                    if (distance(a, c) >= removed) {
+                        break;
+                    }
+                    if ((position_[c] + n - position_[s1]) % n < length) {
+                        continue;
+                    }
+                    // Insert between u -> v, with `a` next to c.
+                    for (const bool after : {true, false}) {
+                        const std::uint32_t u = after ? c : previous(c);
+                        const std::uint32_t v = after ? next(c) : c;
+                        if (u == p || v == p || (position_[u] + n - position_[s1]) % n < length) {
+                            continue;
+                        }
+                        const bool reversed = after ? (a == s2 && a != s1) : (a == s1 && a != s2);
+                        const std::uint32_t first = reversed ? s2 : s1;
+                        const std::uint32_t last = reversed ? s1 : s2;
+                        const double delta = distance(u, first) + distance(last, v) - distance(u, v) - removed;
+                        if (delta < -tolerance * removed) {
+                            move_segment(s1, s2, p, q, u, v, reversed);
+                            activate(p);
+                            activate(q);
+                            activate(s1);
+                            activate(s2);
+                            activate(u);
+                            activate(v);
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    // Moves the segment p -> s1 ... s2 -> q between u -> v, as u s2 ... s1 v if `reversed` and u s1 ... s2 v otherwise.
+    void move_segment(std::uint32_t s1, std::uint32_t s2, std::uint32_t p, std::uint32_t q, std::uint32_t u,
+                      std::uint32_t v, bool reversed) noexcept
+    {
+        // p s1 .. s2 q .. u v  ->  p u .. q s2 .. s1 v  ->  p q .. u s2 .. s1 v
+        move(p, s1, u, v);
+        move(p, u, q, s2);
+        if (!reversed) {
+            move(u, s2, s1, v);
+        }
+    }
+};
+
+} // namespace dm
@@ -97,22 +97,30 @@ class Vec2
 
     constexpr Vec2<T>& operator-=(const Vec2<T>& other) noexcept
     {
-        return *this = *this - other;
+        elements_[x_axis] -= other.x();
+        elements_[y_axis] -= other.y();
+        return *this;
     }
 
     constexpr Vec2<T>& operator+=(const Vec2<T>& other) noexcept
     {
-        return *this = *this + other;
+        elements_[x_axis] += other.x();
+        elements_[y_axis] += other.y();
+        return *this;
     }
 
     constexpr Vec2<T>& operator*=(T n) noexcept
     {
-        return *this = *this * n;
+        elements_[x_axis] *= n;
+        elements_[y_axis] *= n;
+        return *this;
     }
 
     constexpr Vec2<T>& operator/=(T n) noexcept
     {
-        return *this = *this / n;
+        elements_[x_axis] /= n;
+        elements_[y_axis] /= n;
+        return *this;
     }
 
     [[nodiscard]] constexpr T magnitude_squared() const noexcept
@@ -0,0 +1,618 @@
+#pragma once
+
+#include "vec2.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dm {
+
+// Readers and writers for the Well-Known Binary and Well-Known Text encodings of 2D geometries (OGC Simple Features).
+// Geometry collections and coordinates with Z or M are not supported. WKB may be extended (EWKB), as sent by PostGIS;
+// its SRID is skipped.
+
+enum class GeometryType : std::uint32_t
+{
+    point = 1,
+    line_string = 2,
+    polygon = 3,
+    multi_point = 4,
+    multi_line_string = 5,
+    multi_polygon = 6,
+};
+
+// Geometries flattened into one coordinate buffer. Each geometry is a range of parts (points, line strings or
+// polygons), each part a range of rings, each ring a range of points; a point or line string is a part with a single
+// ring, and an empty part has none. Geometry g owns parts [geometry_offsets[g], geometry_offsets[g + 1]), and so on
+// down to the points.
+struct GeometryBuffer
+{
+    std::vector<GeometryType> types;
+    std::vector<std::uint32_t> geometry_offsets{0};
+    std::vector<std::uint32_t> part_offsets{0};
+    std::vector<std::uint32_t> ring_offsets{0};
+    std::vector<Vec2<double>> points;
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return types.size();
+    }
+
+    [[nodiscard]] std::span<const Vec2<double>> ring(std::size_t index) const noexcept
+    {
+        return std::span{points}.subspan(ring_offsets[index], ring_offsets[index + 1] - ring_offsets[index]);
+    }
+
+    void clear()
+    {
+        *this = {};
+    }
+};
+
+namespace detail {
+
+[[nodiscard]] constexpr std::uint64_t byteswap(std::uint64_t value) noexcept
+{
+    value = ((value & 0x00FF00FF00FF00FFull) << 8) | ((value >> 8) & 0x00FF00FF00FF00FFull);
+    value = ((value & 0x0000FFFF0000FFFFull) << 16) | ((value >> 16) & 0x0000FFFF0000FFFFull);
+    return (value << 32) | (value >> 32);
+}
+
+[[nodiscard]] constexpr std::uint32_t byteswap(std::uint32_t value) noexcept
+{
+    value = ((value & 0x00FF00FFu) << 8) | ((value >> 8) & 0x00FF00FFu);
+    return (value << 16) | (value >> 16);
+}
+
+// Undoes the changes to a GeometryBuffer made by a parse that then fails.
+class GeometryCheckpoint
+{
+  public:
+    explicit GeometryCheckpoint(GeometryBuffer& geometries) noexcept
+        : geometries_{geometries}, sizes_{geometries.types.size(), geometries.geometry_offsets.size(),
+                                          geometries.part_offsets.size(), geometries.ring_offsets.size(),
+                                          geometries.points.size()}
+    {
+    }
+
+    [[nodiscard]] bool rollback() const
+    {
+        geometries_.types.resize(sizes_[0]);
+        geometries_.geometry_offsets.resize(sizes_[1]);
+        geometries_.part_offsets.resize(sizes_[2]);
+        geometries_.ring_offsets.resize(sizes_[3]);
+        geometries_.points.resize(sizes_[4]);
+        return false;
+    }
+
+  private:
+    GeometryBuffer& geometries_;
+    std::array<std::size_t, 5> sizes_;
+};
+
+class WkbReader
+{
+  public:
+    WkbReader(std::span<const std::byte> bytes, GeometryBuffer& geometries) noexcept
+        : bytes_{bytes}, geometries_{geometries}
+    {
+    }
+
+    [[nodiscard]] bool geometry()
+    {
+        GeometryType type;
+        if (!header(type)) {
+            return false;
+        }
+        bool parsed = false;
+        switch (type) {
+        case GeometryType::point:
+        case GeometryType::line_string:
+        case GeometryType::polygon:
+            parsed = part(type);
+            break;
+        case GeometryType::multi_point:
+        case GeometryType::multi_line_string:
+        case GeometryType::multi_polygon:
+            parsed = parts(static_cast<GeometryType>(static_cast<std::uint32_t>(type) - 3));
+            break;
+        }
+        if (!parsed) {
+            return false;
+        }
+        geometries_.types.push_back(type);
+        geometries_.geometry_offsets.push_back(static_cast<std::uint32_t>(geometries_.part_offsets.size() - 1));
+        return true;
+    }
+
+    [[nodiscard]] bool at_end() const noexcept
+    {
+        return bytes_.empty();
+    }
+
+  private:
+    std::span<const std::byte> bytes_;
+    GeometryBuffer& geometries_;
+    bool swap_ = false;
+
+    [[nodiscard]] bool skip(std::size_t count) noexcept
+    {
+        if (bytes_.size() < count) {
+            return false;
+        }
+        bytes_ = bytes_.subspan(count);
+        return true;
+    }
+
+    [[nodiscard]] bool read(std::uint32_t& value) noexcept
+    {
+        if (bytes_.size() < sizeof(value)) {
+            return false;
+        }
+        std::memcpy(&value, bytes_.data(), sizeof(value));
+        value = swap_ ? byteswap(value) : value;
+        bytes_ = bytes_.subspan(sizeof(value));
+        return true;
+    }
+
+    // Byte order and type; every geometry, even one nested in a multi geometry, has its own byte order.
+    [[nodiscard]] bool header(GeometryType& type) noexcept
+    {
+        if (bytes_.empty() || static_cast<unsigned>(bytes_[0]) > 1) {
+            return false;
+        }
+        const bool little = bytes_[0] == std::byte{1};
+        swap_ = little != (std::endian::native == std::endian::little);
+        bytes_ = bytes_.subspan(1);
+        std::uint32_t code;
+        if (!read(code)) {
+            return false;
+        }
+        constexpr std::uint32_t ewkb_z = 0x80000000u;
+        constexpr std::uint32_t ewkb_m = 0x40000000u;
+        constexpr std::uint32_t ewkb_srid = 0x20000000u;
+        if ((code & ewkb_srid) != 0 && !skip(4)) {
+            return false;
+        }
+        code &= ~ewkb_srid;
+        if ((code & (ewkb_z | ewkb_m)) != 0 || code < 1 || code > 6) {
+            return false;
+        }
+        type = static_cast<GeometryType>(code);
+        return true;
+    }
+
+    // Appends `count` coordinate pairs as one ring. An empty ring is not stored, so an empty line string becomes an
+    // empty part, as it does when read from WKT.
+    [[nodiscard]] bool ring(std::uint32_t count)
+    {
+        constexpr std::size_t point_bytes = 2 * sizeof(double);
+        if (bytes_.size() / point_bytes < count) {
+            return false;
+        }
+        if (count == 0) {
+            return true;
+        }
+        const std::size_t first = geometries_.points.size();
+        geometries_.points.resize(first + count);
+        // Locals rather than members: stores through std::byte may alias anything reached through `this`, which
+        // would keep the swapping loop scalar.
+        const std::byte* const source = bytes_.data();
+        std::byte* const target = reinterpret_cast<std::byte*>(geometries_.points.data() + first);
+        if (!swap_) {
+            std::memcpy(target, source, count * point_bytes);
+        } else {
+            for (std::size_t i = 0; i < 2 * std::size_t{count}; ++i) {
+                std::uint64_t word;
+                std::memcpy(&word, source + i * sizeof(word), sizeof(word));
+                word = byteswap(word);
+                std::memcpy(target + i * sizeof(word), &word, sizeof(word));
+            }
+        }
+        bytes_ = bytes_.subspan(count * point_bytes);
+        geometries_.ring_offsets.push_back(static_cast<std::uint32_t>(geometries_.points.size()));
+        return true;
+    }
+
+    // The body of a point, line string or polygon, as one part.
+    [[nodiscard]] bool part(GeometryType type)
+    {
+        std::uint32_t count = 1;
+        if (type != GeometryType::point && !read(count)) {
+            return false;
+        }
+        if (type == GeometryType::polygon) {
+            // Every ring takes at least its 4 byte point count, which bounds the rings before reading them.
+            if (bytes_.size() / 4 < count) {
+                return false;
+            }
+            const std::size_t first_ring = geometries_.ring_offsets.size();
+            bool empty_exterior = false;
+            for (std::uint32_t i = 0; i < count; ++i) {
+                std::uint32_t points;
+                if (!read(points) || !ring(points)) {
+                    return false;
+                }
+                empty_exterior = empty_exterior || (i == 0 && points == 0);
+            }
+            // Empty holes are dropped by ring(); holes without an exterior ring bound nothing, so such a polygon is
+            // empty.
+            if (empty_exterior) {
+                geometries_.points.resize(geometries_.ring_offsets[first_ring - 1]);
+                geometries_.ring_offsets.resize(first_ring);
+            }
+        } else if (!ring(count)) {
+            return false;
+        }
+        // WKB has no empty point but NaN coordinates, by convention.
+        if (type == GeometryType::point && std::isnan(geometries_.points.back().x()) &&
+            std::isnan(geometries_.points.back().y())) {
+            geometries_.points.pop_back();
+            geometries_.ring_offsets.pop_back();
+        }
+        geometries_.part_offsets.push_back(static_cast<std::uint32_t>(geometries_.ring_offsets.size() - 1));
+        return true;
+    }
+
+    // The members of a multi geometry, each a whole geometry of type `member`.
+    [[nodiscard]] bool parts(GeometryType member)
+    {
+        std::uint32_t count;
+        if (!read(count)) {
+            return false;
+        }
+        for (std::uint32_t i = 0; i < count; ++i) {
+            GeometryType type;
+            if (!header(type) || type != member || !part(type)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+class WktReader
+{
+  public:
+    WktReader(std::string_view text, GeometryBuffer& geometries) noexcept : text_{text}, geometries_{geometries}
+    {
+    }
+
+    [[nodiscard]] bool geometry()
+    {
+        constexpr std::array<std::string_view, 6> names{"POINT",      "LINESTRING",      "POLYGON",
+                                                        "MULTIPOINT", "MULTILINESTRING", "MULTIPOLYGON"};
+        const std::string_view word = keyword();
+        std::size_t index = 0;
+        while (index < names.size() && !equal_ignoring_case(word, names[index])) {
+            ++index;
+        }
+        if (index == names.size()) {
+            return false;
+        }
+        const auto type = static_cast<GeometryType>(index + 1);
+        bool parsed = false;
+        switch (type) {
+        case GeometryType::point:
+        case GeometryType::line_string:
+        case GeometryType::polygon:
+            parsed = part(type);
+            break;
+        case GeometryType::multi_point:
+        case GeometryType::multi_line_string:
+        case GeometryType::multi_polygon:
+            parsed = parts(static_cast<GeometryType>(index - 2));
+            break;
+        }
+        skip_space();
+        if (!parsed || !text_.empty()) {
+            return false;
+        }
+        geometries_.types.push_back(type);
+        geometries_.geometry_offsets.push_back(static_cast<std::uint32_t>(geometries_.part_offsets.size() - 1));
+        return true;
+    }
+
+  private:
+    std::string_view text_;
+    GeometryBuffer& geometries_;
+
+    [[nodiscard]] static bool equal_ignoring_case(std::string_view word, std::string_view upper) noexcept
+    {
+        return word.size() == upper.size() && std::equal(word.begin(), word.end(), upper.begin(), [](char a, char b) {
+                   return (a >= 'a' && a <= 'z' ? static_cast<char>(a - 'a' + 'A') : a) == b;
+               });
+    }
+
+    void skip_space() noexcept
+    {
+        while (!text_.empty() && (text_[0] == ' ' || text_[0] == '\t' || text_[0] == '\n' || text_[0] == '\r')) {
+            text_.remove_prefix(1);
+        }
+    }
+
+    [[nodiscard]] std::string_view keyword() noexcept
+    {
+        skip_space();
+        std::size_t length = 0;
+        while (length < text_.size() && ((text_[length] >= 'A' && text_[length] <= 'Z') ||
+                                         (text_[length] >= 'a' && text_[length] <= 'z'))) {
+            ++length;
+        }
+        const std::string_view word = text_.substr(0, length);
+        text_.remove_prefix(length);
+        return word;
+    }
+
+    [[nodiscard]] bool consume(char symbol) noexcept
+    {
+        skip_space();
+        if (text_.empty() || text_[0] != symbol) {
+            return false;
+        }
+        text_.remove_prefix(1);
+        return true;
+    }
+
+    // EMPTY in place of a parenthesised body.
+    [[nodiscard]] bool empty_body() noexcept
+    {
+        skip_space();
+        const std::string_view rest = text_;
+        if (equal_ignoring_case(keyword(), "EMPTY")) {
+            return true;
+        }
+        text_ = rest;
+        return false;
+    }
+
+    [[nodiscard]] bool number(double& value) noexcept
+    {
+        skip_space();
+        const auto [end, error] = std::from_chars(text_.data(), text_.data() + text_.size(), value);
+        if (error != std::errc{}) {
+            return false;
+        }
+        text_.remove_prefix(static_cast<std::size_t>(end - text_.data()));
+        return true;
+    }
+
+    [[nodiscard]] bool coordinate()
+    {
+        double x;
+        double y;
+        if (!number(x) || !number(y)) {
+            return false;
+        }
+        geometries_.points.push_back(Vec2<double>(x, y));
+        return true;
+    }
+
+    // "(x y, x y, ...)" as one ring.
+    [[nodiscard]] bool ring()
+    {
+        if (!consume('(')) {
+            return false;
+        }
+        do {
+            if (!coordinate()) {
+                return false;
+            }
+        } while (consume(','));
+        geometries_.ring_offsets.push_back(static_cast<std::uint32_t>(geometries_.points.size()));
+        return consume(')');
+    }
+
+    // The body of a point, line string or polygon, or EMPTY, as one part. A point may lack its parentheses inside a
+    // multi point.
+    [[nodiscard]] bool part(GeometryType type, bool bare_point = false)
+    {
+        if (!empty_body()) {
+            if (type == GeometryType::polygon) {
+                if (!consume('(')) {
+                    return false;
+                }
+                do {
+                    if (!ring()) {
+                        return false;
+                    }
+                } while (consume(','));
+                if (!consume(')')) {
+                    return false;
+                }
+            } else if (bare_point) {
+                if (!coordinate()) {
+                    return false;
+                }
+                geometries_.ring_offsets.push_back(static_cast<std::uint32_t>(geometries_.points.size()));
+            } else if (!ring() || (type == GeometryType::point && geometries_.ring(ring_count() - 1).size() != 1)) {
+                return false;
+            }
+        }
+        geometries_.part_offsets.push_back(static_cast<std::uint32_t>(ring_count()));
+        return true;
+    }
+
+    [[nodiscard]] bool parts(GeometryType member)
+    {
+        if (empty_body()) {
+            return true;
+        }
+        if (!consume('(')) {
+            return false;
+        }
+        do {
+            skip_space();
+            const bool bare_point = member == GeometryType::point && !text_.empty() && text_[0] != '(';
+            if (!part(member, bare_point)) {
+                return false;
+            }
+        } while (consume(','));
+        return consume(')');
+    }
+
+    [[nodiscard]] std::size_t ring_count() const noexcept
+    {
+        return geometries_.ring_offsets.size() - 1;
+    }
+};
+
+inline void append_number(std::string& text, double value)
+{
+    std::array<char, 32> digits;
+    const auto [end, error] = std::to_chars(digits.data(), digits.data() + digits.size(), value);
+    text.append(digits.data(), end);
+}
+
+inline void append_ring(std::string& text, std::span<const Vec2<double>> points)
+{
+    text += '(';
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        if (i != 0) {
+            text += ", ";
+        }
+        append_number(text, points[i].x());
+        text += ' ';
+        append_number(text, points[i].y());
+    }
+    text += ')';
+}
+
+// A part without its type name: "(x y)", "(x y, ...)", "((x y, ...), ...)" or "EMPTY". WKT has no empty ring, so a
+// part whose first ring is empty is written as EMPTY and empty holes are left out.
+inline void append_part(std::string& text, const GeometryBuffer& geometries, std::size_t part, GeometryType type)
+{
+    const std::uint32_t first = geometries.part_offsets[part];
+    const std::uint32_t last = geometries.part_offsets[part + 1];
+    if (first == last || geometries.ring(first).empty()) {
+        text += "EMPTY";
+    } else if (type != GeometryType::polygon) {
+        append_ring(text, geometries.ring(first));
+    } else {
+        text += '(';
+        for (std::uint32_t ring = first; ring < last; ++ring) {
+            if (geometries.ring(ring).empty()) {
+                continue;
+            }
+            if (ring != first) {
+                text += ", ";
+            }
+            append_ring(text, geometries.ring(ring));
+        }
+        text += ')';
+    }
+}
+
+template <typename Integer>
+void append_native(std::vector<std::byte>& bytes, Integer value)
+{
+    const auto* first = reinterpret_cast<const std::byte*>(&value);
+    bytes.insert(bytes.end(), first, first + sizeof(value));
+}
+
+inline void append_wkb_part(std::vector<std::byte>& bytes, const GeometryBuffer& geometries, std::size_t part,
+                            GeometryType type)
+{
+    const std::uint32_t first = geometries.part_offsets[part];
+    const std::uint32_t last = geometries.part_offsets[part + 1];
+    const auto append_points = [&](std::span<const Vec2<double>> points) {
+        const auto* data = reinterpret_cast<const std::byte*>(points.data());
+        bytes.insert(bytes.end(), data, data + points.size_bytes());
+    };
+    bytes.push_back(std::byte{std::endian::native == std::endian::little});
+    append_native(bytes, static_cast<std::uint32_t>(type));
+    if (type == GeometryType::point) {
+        constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+        const Vec2<double> empty(nan, nan);
+        append_points(first == last ? std::span{&empty, 1} : geometries.ring(first));
+    } else if (type == GeometryType::line_string) {
+        const std::span<const Vec2<double>> points =
+            first == last ? std::span<const Vec2<double>>{} : geometries.ring(first);
+        append_native(bytes, static_cast<std::uint32_t>(points.size()));
+        append_points(points);
+    } else {
+        append_native(bytes, last - first);
+        for (std::uint32_t ring = first; ring < last; ++ring) {
+            append_native(bytes, static_cast<std::uint32_t>(geometries.ring(ring).size()));
+            append_points(geometries.ring(ring));
+        }
+    }
+}
+
+} // namespace detail
+
+// Appends the geometry encoded in `wkb` to `geometries`. False, leaving `geometries` as it was, if the encoding is
+// malformed, unsupported or followed by extra bytes. Coordinates in the native byte order are copied as they are, and
+// the others are swapped in a loop that GCC vectorizes at -O3.
+[[nodiscard]] inline bool parse_wkb(std::span<const std::byte> wkb, GeometryBuffer& geometries)
+{
+    const detail::GeometryCheckpoint checkpoint{geometries};
+    detail::WkbReader reader{wkb, geometries};
+    return (reader.geometry() && reader.at_end()) || checkpoint.rollback();
+}
+
+// Appends geometry `index` as WKB in the native byte order.
+inline void write_wkb(const GeometryBuffer& geometries, std::size_t index, std::vector<std::byte>& wkb)
+{
+    const GeometryType type = geometries.types[index];
+    const std::uint32_t first = geometries.geometry_offsets[index];
+    const std::uint32_t last = geometries.geometry_offsets[index + 1];
+    if (type <= GeometryType::polygon) {
+        detail::append_wkb_part(wkb, geometries, first, type);
+        return;
+    }
+    wkb.push_back(std::byte{std::endian::native == std::endian::little});
+    detail::append_native(wkb, static_cast<std::uint32_t>(type));
+    detail::append_native(wkb, last - first);
+    for (std::uint32_t part = first; part < last; ++part) {
+        detail::append_wkb_part(wkb, geometries, part,
+                                static_cast<GeometryType>(static_cast<std::uint32_t>(type) - 3));
+    }
+}
+
+// Appends the geometry written in `wkt` to `geometries`; keywords are case-insensitive. False, leaving `geometries` as
+// it was, if the text is malformed or unsupported.
+[[nodiscard]] inline bool parse_wkt(std::string_view wkt, GeometryBuffer& geometries)
+{
+    const detail::GeometryCheckpoint checkpoint{geometries};
+    return detail::WktReader{wkt, geometries}.geometry() || checkpoint.rollback();
+}
+
+// Appends geometry `index` as WKT, with every coordinate in the shortest form that reads back exactly.
+inline void write_wkt(const GeometryBuffer& geometries, std::size_t index, std::string& wkt)
+{
+    constexpr std::array<std::string_view, 6> names{"POINT ",      "LINESTRING ",      "POLYGON ",
+                                                    "MULTIPOINT ", "MULTILINESTRING ", "MULTIPOLYGON "};
+    const GeometryType type = geometries.types[index];
+    const std::uint32_t first = geometries.geometry_offsets[index];
+    const std::uint32_t last = geometries.geometry_offsets[index + 1];
+    wkt += names[static_cast<std::uint32_t>(type) - 1];
+    if (type <= GeometryType::polygon) {
+        detail::append_part(wkt, geometries, first, type);
+    } else if (first == last) {
+        wkt += "EMPTY";
+    } else {
+        wkt += '(';
+        for (std::uint32_t part = first; part < last; ++part) {
+            if (part != first) {
+                wkt += ", ";
+            }
+            detail::append_part(wkt, geometries, part, static_cast<GeometryType>(static_cast<std::uint32_t>(type) - 3));
+        }
+        wkt += ')';
+    }
+}
+
+} // namespace dm